@@ -0,0 +1,350 @@
+#include "Autotune.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <cstdlib>
+#endif
+
+namespace nn {
+
+    namespace {
+
+        // Best seconds per call of fn. The run count doubles until one measurement lasts min_seconds,
+        // so fast kernels are not lost in timer noise.
+        template <typename Fn>
+        double seconds_per_call(Fn fn, const TuneOptions& options) {
+            typedef std::chrono::steady_clock clock;
+            auto measure = [&](size_t runs) {
+                clock::time_point start = clock::now();
+                for (size_t r = 0; r < runs; ++r) fn();
+                return std::chrono::duration<double>(clock::now() - start).count();
+            };
+
+            fn();
+            size_t runs = 1;
+            while (measure(runs) < options.min_seconds && runs < (size_t(1) << 20)) runs *= 2;
+
+            double best = std::numeric_limits<double>::infinity();
+            for (size_t r = 0; r < std::max<size_t>(1, options.repeats); ++r) {
+                best = std::min(best, measure(runs) / runs);
+            }
+            return best;
+        }
+
+        // Powers of two in [smallest, largest]; sizes past the problem extent collapse into one candidate.
+        std::vector<size_t> block_candidates(size_t smallest, size_t largest, size_t extent) {
+            std::vector<size_t> sizes;
+            for (size_t size = smallest; size <= largest; size *= 2) {
+                size_t effective = std::min(size, std::max<size_t>(1, extent));
+                if (std::find(sizes.begin(), sizes.end(), effective) == sizes.end()) sizes.push_back(effective);
+            }
+            return sizes;
+        }
+
+        std::vector<size_t> thread_candidates(size_t max_threads) {
+            if (max_threads == 0) max_threads = std::max(1u, std::thread::hardware_concurrency());
+            std::vector<size_t> counts;
+            for (size_t n = 1; n < max_threads; n *= 2) counts.push_back(n);
+            counts.push_back(max_threads);
+            return counts;
+        }
+
+        std::vector<double> random_inputs(size_t count) {
+            std::mt19937 rng(12345);
+            std::uniform_real_distribution<double> dist(-1.0, 1.0);
+            std::vector<double> values(count);
+            for (double& v : values) v = dist(rng);
+            return values;
+        }
+
+        ConvProfile tune_conv(ConvLayer& layer, size_t index, const TuneOptions& options) {
+            std::vector<double> in = random_inputs(layer.input_size());
+            std::vector<double> out(layer.output_size());
+            auto run = [&]() { layer.infer(in.data(), out.data()); };
+
+            size_t K = static_cast<size_t>(layer.in_channels) * layer.kernel_size * layer.kernel_size;
+            size_t N = static_cast<size_t>(layer.out_height) * layer.out_width;
+
+            // Tiles first on one thread, where the cache effects are cleanest, then the thread count
+            ConvProfile best{ index, layer.tuning, std::numeric_limits<double>::infinity(), 0.0 };
+            best.tuning.threads = 1;
+            for (size_t block_k : block_candidates(16, 256, K)) {
+                for (size_t block_n : block_candidates(64, 1024, N)) {
+                    layer.tuning = best.tuning;
+                    layer.tuning.block_k = block_k;
+                    layer.tuning.block_n = block_n;
+                    double seconds = seconds_per_call(run, options);
+                    if (seconds < best.seconds) {
+                        best.tuning = layer.tuning;
+                        best.seconds = seconds;
+                    }
+                }
+            }
+            for (size_t threads : thread_candidates(options.max_threads)) {
+                if (threads == 1) continue;
+                layer.tuning = best.tuning;
+                layer.tuning.threads = threads;
+                double seconds = seconds_per_call(run, options);
+                if (seconds < best.seconds) {
+                    best.tuning = layer.tuning;
+                    best.seconds = seconds;
+                }
+            }
+
+            // Backward pass on a scratch copy, so the real layer's weights and caches stay as they were
+            std::unique_ptr<ConvLayer> scratch(static_cast<ConvLayer*>(layer.clone()));
+            scratch->activate(in);
+            std::vector<double> deltas = random_inputs(layer.output_size());
+            auto run_backward = [&]() { scratch->backpropagate(deltas, 0.0); };
+
+            best.backward_seconds = std::numeric_limits<double>::infinity();
+            for (size_t threads : thread_candidates(options.max_threads)) {
+                scratch->tuning.backward_threads = threads;
+                double seconds = seconds_per_call(run_backward, options);
+                if (seconds < best.backward_seconds) {
+                    best.tuning.backward_threads = threads;
+                    best.backward_seconds = seconds;
+                }
+            }
+
+            layer.tuning = best.tuning;
+            return best;
+        }
+
+        DenseProfile tune_dense(Layer& layer, size_t index, const TuneOptions& options) {
+            size_t batch = std::max<size_t>(1, options.batch);
+            std::vector<double> in = random_inputs(batch * layer.get_input_size());
+            std::vector<double> out(batch * layer.get_nodes().size());
+            auto run = [&]() { layer.infer_batch(in.data(), batch, out.data()); };
+
+            DenseProfile best{ index, layer.infer_block, 1, std::numeric_limits<double>::infinity() };
+            layer.infer_threads = 1;
+            for (size_t block : block_candidates(1, 128, batch)) {
+                layer.infer_block = block;
+                double seconds = seconds_per_call(run, options);
+                if (seconds < best.seconds) {
+                    best.block = block;
+                    best.seconds = seconds;
+                }
+            }
+            layer.infer_block = best.block;
+            for (size_t threads : thread_candidates(options.max_threads)) {
+                if (threads == 1) continue;
+                layer.infer_threads = threads;
+                double seconds = seconds_per_call(run, options);
+                if (seconds < best.seconds) {
+                    best.threads = threads;
+                    best.seconds = seconds;
+                }
+            }
+
+            layer.infer_threads = best.threads;
+            return best;
+        }
+
+    }
+
+    std::string topology_key(const Net& net) {
+        std::ostringstream key;
+        const char* separator = "";
+        for (const SpatialLayer* layer : net.spatial_layers) {
+            key << separator;
+            separator = "|";
+            if (const ConvLayer* conv = dynamic_cast<const ConvLayer*>(layer)) {
+                key << "conv" << conv->in_channels << "x" << conv->in_height << "x" << conv->in_width << ":"
+                    << conv->out_channels << "k" << conv->kernel_size << "s" << conv->stride << "p" << conv->padding;
+            }
+            else if (const PoolLayer* pool = dynamic_cast<const PoolLayer*>(layer)) {
+                key << "pool" << pool->in_channels << "x" << pool->in_height << "x" << pool->in_width << ":"
+                    << (pool->pool_type == PoolType::Max ? "max" : "avg") << pool->window << "s" << pool->stride;
+            }
+            else {
+                key << "spatial" << layer->input_size() << ":" << layer->output_size();
+            }
+        }
+        for (const Layer* layer : net.layers) {
+            key << separator << "dense" << layer->get_input_size() << ":" << layer->get_nodes().size();
+            separator = "|";
+        }
+        return key.str();
+    }
+
+    std::string host_key() {
+        std::string name;
+#ifndef _WIN32
+        char buffer[256] = {};
+        if (gethostname(buffer, sizeof(buffer) - 1) == 0) name = buffer;
+#else
+        if (const char* computer = std::getenv("COMPUTERNAME")) name = computer;
+#endif
+        if (name.empty()) name = "unknown";
+        std::replace(name.begin(), name.end(), ' ', '_');
+        return name + "/" + std::to_string(std::thread::hardware_concurrency());
+    }
+
+    TuneProfile autotune(Net& net, const TuneOptions& options) {
+        TuneProfile profile;
+        profile.topology = topology_key(net);
+        profile.host = host_key();
+
+        for (size_t i = 0; i < net.spatial_layers.size(); ++i) {
+            if (ConvLayer* conv = dynamic_cast<ConvLayer*>(net.spatial_layers[i])) {
+                profile.conv_layers.push_back(tune_conv(*conv, i, options));
+            }
+        }
+        for (size_t i = 0; i < net.layers.size(); ++i) {
+            profile.dense_layers.push_back(tune_dense(*net.layers[i], i, options));
+        }
+        return profile;
+    }
+
+    void apply_profile(Net& net, const TuneProfile& profile) {
+        if (profile.topology != topology_key(net)) {
+            throw std::invalid_argument("Tuning profile was measured for a different topology.");
+        }
+
+        for (const ConvProfile& entry : profile.conv_layers) {
+            ConvLayer* conv = entry.index < net.spatial_layers.size()
+                ? dynamic_cast<ConvLayer*>(net.spatial_layers[entry.index]) : nullptr;
+            if (!conv) throw std::invalid_argument("Tuning profile names a convolution layer the net lacks.");
+            conv->tuning = entry.tuning;
+        }
+        for (const DenseProfile& entry : profile.dense_layers) {
+            if (entry.index >= net.layers.size()) {
+                throw std::invalid_argument("Tuning profile names a dense layer the net lacks.");
+            }
+            net.layers[entry.index]->infer_block = entry.block;
+            net.layers[entry.index]->infer_threads = entry.threads;
+        }
+    }
+
+    bool load_profiles(const std::string& fileName, std::vector<TuneProfile>& profiles) {
+        std::ifstream file(fileName);
+        if (!file.is_open()) return false;
+
+        std::vector<TuneProfile> loaded;
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream ss(line);
+            std::string kind;
+            if (!(ss >> kind)) continue;
+
+            // A host line opens the next host's entry
+            if (loaded.empty() || (kind == "host" && !loaded.back().host.empty())) loaded.emplace_back();
+            TuneProfile& profile = loaded.back();
+
+            if (kind == "topology") ss >> profile.topology;
+            else if (kind == "host") ss >> profile.host;
+            else if (kind == "conv") {
+                // index block_k block_n threads seconds [backward_threads backward_seconds]
+                ConvProfile entry;
+                if (!(ss >> entry.index >> entry.tuning.block_k >> entry.tuning.block_n >> entry.tuning.threads
+                    >> entry.seconds)) {
+                    std::cerr << "Malformed tuning profile line: " << line << "\n";
+                    return false;
+                }
+                if (!(ss >> entry.tuning.backward_threads >> entry.backward_seconds)) {
+                    entry.tuning.backward_threads = entry.tuning.threads;
+                    entry.backward_seconds = 0.0;
+                }
+                profile.conv_layers.push_back(entry);
+            }
+            else if (kind == "dense") {
+                DenseProfile entry;
+                if (!(ss >> entry.index >> entry.block >> entry.threads >> entry.seconds)) {
+                    std::cerr << "Malformed tuning profile line: " << line << "\n";
+                    return false;
+                }
+                profile.dense_layers.push_back(entry);
+            }
+        }
+
+        profiles = loaded;
+        return true;
+    }
+
+    bool load_profile(const std::string& fileName, const std::string& host, TuneProfile& profile) {
+        std::vector<TuneProfile> profiles;
+        if (!load_profiles(fileName, profiles)) return false;
+        for (const TuneProfile& entry : profiles) {
+            if (entry.host == host) {
+                profile = entry;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool save_profile(const std::string& fileName, const TuneProfile& profile) {
+        std::vector<TuneProfile> profiles;
+        load_profiles(fileName, profiles);
+        profiles.erase(std::remove_if(profiles.begin(), profiles.end(),
+            [&](const TuneProfile& entry) { return entry.host == profile.host; }), profiles.end());
+        profiles.push_back(profile);
+
+        // Written aside and renamed, so a host reading the file never sees it half written
+        const std::string temp = fileName + ".tmp";
+        {
+            std::ofstream file(temp);
+            if (!file.is_open()) {
+                std::cerr << "Error: Could not write tuning profile " << fileName << "\n";
+                return false;
+            }
+
+            for (const TuneProfile& entry : profiles) {
+                file << "host " << entry.host << "\n";
+                file << "topology " << entry.topology << "\n";
+                for (const ConvProfile& conv : entry.conv_layers) {
+                    file << "conv " << conv.index << " " << conv.tuning.block_k << " " << conv.tuning.block_n
+                        << " " << conv.tuning.threads << " " << conv.seconds
+                        << " " << conv.tuning.backward_threads << " " << conv.backward_seconds << "\n";
+                }
+                for (const DenseProfile& dense : entry.dense_layers) {
+                    file << "dense " << dense.index << " " << dense.block << " " << dense.threads
+                        << " " << dense.seconds << "\n";
+                }
+            }
+            if (!file) {
+                std::cerr << "Error: Could not write tuning profile " << fileName << "\n";
+                return false;
+            }
+        }
+
+        if (std::rename(temp.c_str(), fileName.c_str()) != 0) {
+            // Windows will not rename over an existing file
+            std::remove(fileName.c_str());
+            if (std::rename(temp.c_str(), fileName.c_str()) != 0) {
+                std::cerr << "Error: Could not replace tuning profile " << fileName << "\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool tune_net(Net& net, const std::string& fileName, const TuneOptions& options) {
+        std::string profileName = fileName + ".tune";
+
+        TuneProfile profile;
+        if (load_profile(profileName, host_key(), profile) && profile.topology == topology_key(net)) {
+            apply_profile(net, profile);
+            return true;
+        }
+
+        profile = autotune(net, options);
+        save_profile(profileName, profile);
+        return false;
+    }
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Net.hpp"
+#include <string>
+#include <vector>
+
+namespace nn {
+
+    struct TuneOptions {
+        size_t batch = 64;              // dense layers are tuned for infer_batch calls of this size
+        double min_seconds = 0.002;     // every measurement repeats a candidate for at least this long
+        size_t repeats = 3;             // the best of this many measurements counts
+        size_t max_threads = 0;         // 0 means up to one per hardware thread
+    };
+
+    struct ConvProfile {
+        size_t index;                   // into Net::spatial_layers
+        ConvTuning tuning;
+        double seconds;                 // per forward pass of one sample
+        double backward_seconds;        // per backpropagate of one sample
+    };
+
+    struct DenseProfile {
+        size_t index;                   // into Net::layers
+        size_t block;
+        size_t threads;
+        double seconds;                 // per infer_batch call of TuneOptions::batch samples
+    };
+
+    // Winning kernel settings for one topology on one host. Pooling layers have nothing to tune.
+    struct TuneProfile {
+        std::string topology;
+        std::string host;
+        std::vector<ConvProfile> conv_layers;
+        std::vector<DenseProfile> dense_layers;
+    };
+
+    // Layer kinds and shapes in order, e.g. "conv1x28x28:8k3s1p1|pool8x28x28:max2s2|dense1568:10".
+    std::string topology_key(const Net& net);
+
+    // Host name plus hardware thread count; a profile only applies on the host that measured it.
+    std::string host_key();
+
+    // Times candidate block sizes and thread counts for every convolution and dense layer, keeps the
+    // fastest on each layer and returns them. Convolution layers get a forward setting and a separate
+    // backward thread count, the latter timed on a scratch copy of the layer. The dense training path
+    // (Node::activate and backpropagate) has no knobs and is not tuned; dense settings cover
+    // infer_batch only. Runs forward passes on the net, so nothing else may use it meanwhile.
+    TuneProfile autotune(Net& net, const TuneOptions& options = TuneOptions());
+
+    // Throws std::invalid_argument if the profile was measured for a different topology.
+    void apply_profile(Net& net, const TuneProfile& profile);
+
+    // A profile file keeps one entry per host, so hosts sharing a model directory each keep their own.
+    // save_profile replaces only the entry for profile.host; load_profile finds the entry for host.
+    bool save_profile(const std::string& fileName, const TuneProfile& profile);
+    bool load_profile(const std::string& fileName, const std::string& host, TuneProfile& profile);
+    bool load_profiles(const std::string& fileName, std::vector<TuneProfile>& profiles);
+
+    // For a net loaded from fileName (a .snn path): applies this host's entry in "<fileName>.tune" if
+    // it was measured for this topology and returns true; otherwise tunes the net, stores the entry
+    // next to the other hosts' and returns false.
+    bool tune_net(Net& net, const std::string& fileName, const TuneOptions& options = TuneOptions());
+
+}
@@ -0,0 +1,166 @@
+#include "Checkpoint.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace nn {
+
+    namespace {
+
+        bool write_all(int fd, const std::string& data) {
+            size_t offset = 0;
+            while (offset < data.size()) {
+#ifdef _WIN32
+                int written = _write(fd, data.data() + offset, static_cast<unsigned int>(data.size() - offset));
+#else
+                ssize_t written = ::write(fd, data.data() + offset, data.size() - offset);
+#endif
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                offset += static_cast<size_t>(written);
+            }
+            return true;
+        }
+
+    }
+
+    Checkpointer::Checkpointer(const std::string& fileName)
+        : file_name(fileName)
+    {
+        worker = std::thread(&Checkpointer::run, this);
+    }
+
+    Checkpointer::~Checkpointer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_ready.notify_one();
+        worker.join();
+    }
+
+    void Checkpointer::checkpoint(const Net& net) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (has_pending) ++skipped_count;
+            net.snapshot(pending);
+            has_pending = true;
+        }
+        work_ready.notify_one();
+    }
+
+    void Checkpointer::wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        work_done.wait(lock, [this]() { return !has_pending && !busy; });
+    }
+
+    size_t Checkpointer::get_written_count() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return written_count;
+    }
+
+    size_t Checkpointer::get_skipped_count() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return skipped_count;
+    }
+
+    std::string Checkpointer::get_last_error() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return last_error;
+    }
+
+    void Checkpointer::run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            work_ready.wait(lock, [this]() { return has_pending || stopping; });
+            // Pending work is still flushed on shutdown
+            if (!has_pending) break;
+
+            std::swap(pending, writing);
+            has_pending = false;
+            busy = true;
+            lock.unlock();
+
+            std::string error;
+            bool ok = write_file(writing, error);
+
+            lock.lock();
+            busy = false;
+            if (ok) ++written_count;
+            else {
+                last_error = error;
+                std::cerr << "Checkpoint error: " << error << "\n";
+            }
+            work_done.notify_all();
+        }
+        work_done.notify_all();
+    }
+
+    bool Checkpointer::write_file(const NetSnapshot& snapshot, std::string& error) const {
+        std::ostringstream text;
+        write_snapshot(text, snapshot);
+        const std::string data = text.str();
+
+        const std::string target = file_name + ".snn";
+        const std::string temp = target + ".tmp";
+
+#ifdef _WIN32
+        int fd = _open(temp.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+        if (fd < 0) {
+            error = "could not open " + temp + ": " + std::strerror(errno);
+            return false;
+        }
+
+#ifdef _WIN32
+        bool ok = write_all(fd, data) && _commit(fd) == 0;
+        ok = (_close(fd) == 0) && ok;
+#else
+        bool ok = write_all(fd, data) && ::fsync(fd) == 0;
+        ok = (::close(fd) == 0) && ok;
+#endif
+        if (!ok) {
+            error = "could not write " + temp + ": " + std::strerror(errno);
+            std::remove(temp.c_str());
+            return false;
+        }
+
+#ifdef _WIN32
+        if (!MoveFileExA(temp.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+            error = "could not replace " + target;
+            return false;
+        }
+#else
+        if (std::rename(temp.c_str(), target.c_str()) != 0) {
+            error = "could not replace " + target + ": " + std::strerror(errno);
+            return false;
+        }
+
+        // Make the rename itself durable
+        size_t slash = target.find_last_of('/');
+        std::string directory = slash == std::string::npos ? "." : target.substr(0, slash + 1);
+        int dir_fd = ::open(directory.c_str(), O_RDONLY);
+        if (dir_fd >= 0) {
+            ::fsync(dir_fd);
+            ::close(dir_fd);
+        }
+#endif
+        return true;
+    }
+
+}
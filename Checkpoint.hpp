@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Net.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace nn {
+
+    // Writes .snn checkpoints on a background thread so training only pays for copying the weights.
+    //
+    // checkpoint() copies the parameters into a spare buffer and returns; the worker formats the copy,
+    // writes it to "<fileName>.snn.tmp", flushes it to disk and renames it over "<fileName>.snn", so a
+    // crash leaves either the previous checkpoint or the new one, never a truncated file. If the worker
+    // is still busy when two more checkpoints arrive, only the newest of them is written.
+    class Checkpointer {
+    public:
+        explicit Checkpointer(const std::string& fileName);
+        ~Checkpointer();
+
+        Checkpointer(const Checkpointer&) = delete;
+        Checkpointer& operator=(const Checkpointer&) = delete;
+
+        void checkpoint(const Net& net);
+
+        // Blocks until every requested checkpoint has been written (or has failed).
+        void wait();
+
+        size_t get_written_count() const;
+        size_t get_skipped_count() const;
+        std::string get_last_error() const;
+
+    private:
+        void run();
+        bool write_file(const NetSnapshot& snapshot, std::string& error) const;
+
+        std::string file_name;
+
+        // The caller fills pending while the worker writes writing; they swap under the lock.
+        NetSnapshot pending;
+        NetSnapshot writing;
+        bool has_pending = false;
+        bool busy = false;
+        bool stopping = false;
+
+        size_t written_count = 0;
+        size_t skipped_count = 0;
+        std::string last_error;
+
+        mutable std::mutex mutex;
+        std::condition_variable work_ready;
+        std::condition_variable work_done;
+        std::thread worker;
+    };
+
+}
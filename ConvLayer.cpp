@@ -0,0 +1,504 @@
+#include "ConvLayer.hpp"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace nn {
+
+    namespace {
+
+        // Below this many multiply-adds the cost of spawning threads outweighs the work.
+        constexpr size_t kMinParallelWork = 1 << 16;
+
+        // Splits [0, count) into contiguous chunks, one per thread (0: per hardware thread), and runs
+        // body(begin, end) on each. Falls back to the calling thread for small problems.
+        template <typename Body>
+        void parallel_for(size_t count, size_t work_per_item, size_t threads, Body body) {
+            if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+            threads = std::min(threads, count);
+            if (threads <= 1 || count * work_per_item < kMinParallelWork) {
+                body(size_t(0), count);
+                return;
+            }
+
+            std::vector<std::thread> workers;
+            workers.reserve(threads - 1);
+            size_t chunk = (count + threads - 1) / threads;
+            for (size_t begin = chunk; begin < count; begin += chunk) {
+                size_t end = std::min(count, begin + chunk);
+                workers.emplace_back([=]() { body(begin, end); });
+            }
+            body(size_t(0), std::min(count, chunk));
+            for (std::thread& worker : workers) worker.join();
+        }
+
+        // C[m_begin..m_end) += A * B with A (M x K), B (K x N), C (M x N), all row-major.
+        void gemm_rows(size_t m_begin, size_t m_end, size_t N, size_t K,
+            const double* A, const double* B, double* C, size_t block_k, size_t block_n) {
+            for (size_t k0 = 0; k0 < K; k0 += block_k) {
+                size_t k1 = std::min(K, k0 + block_k);
+                for (size_t n0 = 0; n0 < N; n0 += block_n) {
+                    size_t n1 = std::min(N, n0 + block_n);
+                    for (size_t m = m_begin; m < m_end; ++m) {
+                        double* c_row = C + m * N;
+                        for (size_t k = k0; k < k1; ++k) {
+                            double a = A[m * K + k];
+                            const double* b_row = B + k * N;
+                            for (size_t n = n0; n < n1; ++n) c_row[n] += a * b_row[n];
+                        }
+                    }
+                }
+            }
+        }
+
+        std::vector<double> parse_numbers(const std::string& body, std::string& kind, std::string& label) {
+            std::istringstream ss(body);
+            std::string token;
+            std::getline(ss, kind, ',');
+            kind.erase(std::remove_if(kind.begin(), kind.end(), ::isspace), kind.end());
+
+            std::vector<double> values;
+            while (std::getline(ss, token, ',')) {
+                std::string trimmed = token;
+                trimmed.erase(std::remove_if(trimmed.begin(), trimmed.end(), ::isspace), trimmed.end());
+                if (!trimmed.empty() && (std::isalpha(static_cast<unsigned char>(trimmed[0])))) {
+                    label = trimmed;
+                    continue;
+                }
+                values.push_back(std::stod(trimmed));
+            }
+            return values;
+        }
+
+    }
+
+    size_t SpatialLayer::input_size() const {
+        return static_cast<size_t>(in_channels) * in_height * in_width;
+    }
+
+    size_t SpatialLayer::output_size() const {
+        return static_cast<size_t>(out_channels) * out_height * out_width;
+    }
+
+    const std::vector<double>& SpatialLayer::get_outputs() const {
+        return outputs;
+    }
+
+    void SpatialLayer::infer_serial(const double* inputs, double* out, double*) const {
+        // Layers without scratch or threads of their own already meet the contract
+        infer(inputs, out);
+    }
+
+    ConvLayer::ConvLayer(int in_channels_, int in_height_, int in_width_, int out_channels_,
+        int kernel_size_, int stride_, int padding_, ActivationFunction activation_function)
+        : ConvLayer(in_channels_, in_height_, in_width_, out_channels_, kernel_size_, stride_, padding_,
+            activation_function, true) {}
+
+    ConvLayer::ConvLayer(int in_channels_, int in_height_, int in_width_, int out_channels_,
+        int kernel_size_, int stride_, int padding_, ActivationFunction activation_function, bool initialize)
+        : kernel_size(kernel_size_), stride(stride_), padding(padding_), activation(activation_function)
+    {
+        if (in_channels_ <= 0 || in_height_ <= 0 || in_width_ <= 0 || out_channels_ <= 0
+            || kernel_size_ <= 0 || stride_ <= 0 || padding_ < 0) {
+            throw std::invalid_argument("Convolution dimensions must be positive.");
+        }
+
+        in_channels = in_channels_;
+        in_height = in_height_;
+        in_width = in_width_;
+        out_channels = out_channels_;
+        out_height = (in_height + 2 * padding - kernel_size) / stride + 1;
+        out_width = (in_width + 2 * padding - kernel_size) / stride + 1;
+        if (in_height + 2 * padding < kernel_size || in_width + 2 * padding < kernel_size) {
+            throw std::invalid_argument("Convolution kernel is larger than the padded input.");
+        }
+        if (!initialize) return;
+
+        std::random_device rd;
+        std::mt19937 eng(rd());
+
+        size_t fan_in = patch_size();
+        weights.resize(static_cast<size_t>(out_channels) * fan_in);
+        biases.assign(out_channels, 0.0);
+
+        if (activation == ActivationFunction::ReLU || activation == ActivationFunction::LeakyReLU) {
+            std::normal_distribution<> he_dist(0.0, std::sqrt(2.0 / fan_in));
+            for (double& w : weights) w = he_dist(eng);
+        }
+        else {
+            double limit = 1.0 / std::sqrt(static_cast<double>(fan_in));
+            std::uniform_real_distribution<> distr(-limit, limit);
+            for (double& w : weights) w = distr(eng);
+        }
+    }
+
+    size_t ConvLayer::patch_size() const {
+        return static_cast<size_t>(in_channels) * kernel_size * kernel_size;
+    }
+
+    // Unrolls every receptive field into a column so the convolution becomes one matrix product.
+    // columns is (in_channels * k * k) x (out_height * out_width).
+    void ConvLayer::im2col(const double* image, double* cols) const {
+        size_t spatial = static_cast<size_t>(out_height) * out_width;
+        size_t row = 0;
+        for (int c = 0; c < in_channels; ++c) {
+            for (int ky = 0; ky < kernel_size; ++ky) {
+                for (int kx = 0; kx < kernel_size; ++kx, ++row) {
+                    double* dst = cols + row * spatial;
+                    for (int oy = 0; oy < out_height; ++oy) {
+                        int iy = oy * stride - padding + ky;
+                        for (int ox = 0; ox < out_width; ++ox) {
+                            int ix = ox * stride - padding + kx;
+                            bool inside = iy >= 0 && iy < in_height && ix >= 0 && ix < in_width;
+                            dst[oy * out_width + ox] = inside
+                                ? image[(static_cast<size_t>(c) * in_height + iy) * in_width + ix] : 0.0;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Inverse of im2col: scatters column deltas back onto the image, summing overlapping windows.
+    void ConvLayer::col2im(const double* cols, double* image) const {
+        std::fill(image, image + input_size(), 0.0);
+        size_t spatial = static_cast<size_t>(out_height) * out_width;
+        size_t row = 0;
+        for (int c = 0; c < in_channels; ++c) {
+            for (int ky = 0; ky < kernel_size; ++ky) {
+                for (int kx = 0; kx < kernel_size; ++kx, ++row) {
+                    const double* src = cols + row * spatial;
+                    for (int oy = 0; oy < out_height; ++oy) {
+                        int iy = oy * stride - padding + ky;
+                        if (iy < 0 || iy >= in_height) continue;
+                        for (int ox = 0; ox < out_width; ++ox) {
+                            int ix = ox * stride - padding + kx;
+                            if (ix < 0 || ix >= in_width) continue;
+                            image[(static_cast<size_t>(c) * in_height + iy) * in_width + ix] += src[oy * out_width + ox];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void ConvLayer::forward(const double* in, double* cols, double* pre, double* out, size_t threads) const {
+        size_t K = patch_size();
+        size_t N = static_cast<size_t>(out_height) * out_width;
+
+        im2col(in, cols);
+
+        size_t block_k = std::max<size_t>(1, tuning.block_k);
+        size_t block_n = std::max<size_t>(1, tuning.block_n);
+        parallel_for(static_cast<size_t>(out_channels), K * N, threads, [&](size_t begin, size_t end) {
+            for (size_t m = begin; m < end; ++m) std::fill(pre + m * N, pre + (m + 1) * N, biases[m]);
+            gemm_rows(begin, end, N, K, weights.data(), cols, pre, block_k, block_n);
+            for (size_t i = begin * N; i < end * N; ++i) out[i] = apply_activation_function(activation, pre[i]);
+        });
+    }
+
+    const std::vector<double>& ConvLayer::activate(const std::vector<double>& inputs) {
+        if (inputs.size() != input_size()) {
+            throw std::invalid_argument("Input size does not match convolution input shape.");
+        }
+
+        columns.resize(patch_size() * out_height * out_width);
+        pre_activation.resize(output_size());
+        outputs.resize(output_size());
+        forward(inputs.data(), columns.data(), pre_activation.data(), outputs.data(), tuning.threads);
+        return outputs;
+    }
+
+    void ConvLayer::infer(const double* inputs, double* out) const {
+        std::vector<double> cols(patch_size() * out_height * out_width);
+        std::vector<double> pre(output_size());
+        forward(inputs, cols.data(), pre.data(), out, tuning.threads);
+    }
+
+    size_t ConvLayer::scratch_size() const {
+        return patch_size() * out_height * out_width + output_size();
+    }
+
+    void ConvLayer::infer_serial(const double* inputs, double* out, double* scratch) const {
+        double* cols = scratch;
+        double* pre = scratch + patch_size() * out_height * out_width;
+        forward(inputs, cols, pre, out, 1);
+    }
+
+    std::vector<double> ConvLayer::backpropagate(const std::vector<double>& deltas, double learning_rate) {
+        if (deltas.size() != output_size()) {
+            throw std::invalid_argument("Delta size does not match convolution output shape.");
+        }
+
+        size_t K = patch_size();
+        size_t N = static_cast<size_t>(out_height) * out_width;
+        size_t M = static_cast<size_t>(out_channels);
+
+        std::vector<double> local(M * N);
+        for (size_t i = 0; i < local.size(); ++i) {
+            local[i] = deltas[i] * activation_function_derivative(activation, pre_activation[i]);
+        }
+
+        // Input deltas use the weights the forward pass saw: dcol = W^T * local.
+        std::vector<double> col_deltas(K * N, 0.0);
+        parallel_for(K, M * N, tuning.backward_threads, [&](size_t begin, size_t end) {
+            for (size_t m = 0; m < M; ++m) {
+                const double* d_row = local.data() + m * N;
+                for (size_t k = begin; k < end; ++k) {
+                    double w = weights[m * K + k];
+                    double* c_row = col_deltas.data() + k * N;
+                    for (size_t n = 0; n < N; ++n) c_row[n] += w * d_row[n];
+                }
+            }
+        });
+
+        // Weight update: W += lr * local * columns^T, one output channel per row.
+        size_t slots = optimizer ? optimizer->state_slots() : 0;
+        long long step = ++update_count;
+        parallel_for(M, K * N, tuning.backward_threads, [&](size_t begin, size_t end) {
+            std::vector<double> grads(K);
+            for (size_t m = begin; m < end; ++m) {
+                const double* d_row = local.data() + m * N;
+                double bias_grad = 0.0;
+                for (size_t n = 0; n < N; ++n) bias_grad += d_row[n];
+
+                for (size_t k = 0; k < K; ++k) {
+                    const double* c_row = columns.data() + k * N;
+                    double grad = 0.0;
+                    for (size_t n = 0; n < N; ++n) grad += d_row[n] * c_row[n];
+                    grads[k] = grad;
+                }
+
+                if (optimizer) {
+                    optimizer->step(weights.data() + m * K, grads.data(), 1.0, biases[m], bias_grad,
+                        optimizer_state.data() + m * slots * (K + 1), K, learning_rate, step);
+                }
+                else {
+                    for (size_t k = 0; k < K; ++k) weights[m * K + k] += learning_rate * grads[k];
+                    biases[m] += learning_rate * bias_grad;
+                }
+            }
+        });
+
+        std::vector<double> input_deltas(input_size());
+        col2im(col_deltas.data(), input_deltas.data());
+        return input_deltas;
+    }
+
+    void ConvLayer::set_optimizer(const Optimizer* opt) {
+        optimizer = opt;
+        size_t slots = opt ? opt->state_slots() : 0;
+        optimizer_state.assign(static_cast<size_t>(out_channels) * slots * (patch_size() + 1), 0.0);
+        update_count = 0;
+    }
+
+    void ConvLayer::print_parameters(bool verbose) const {
+        std::cout << "Conv2D " << in_channels << "x" << in_height << "x" << in_width
+            << " -> " << out_channels << "x" << out_height << "x" << out_width
+            << " (kernel " << kernel_size << ", stride " << stride << ", padding " << padding
+            << ", " << activation_name(activation) << ")\n";
+        if (!verbose) return;
+
+        std::cout << std::fixed << std::setprecision(10);
+        size_t K = patch_size();
+        for (int m = 0; m < out_channels; ++m) {
+            std::cout << "Filter " << m << "\nWeights: ";
+            for (size_t k = 0; k < K; ++k) std::cout << weights[m * K + k] << " ";
+            std::cout << "\nBias: " << biases[m] << "\n";
+        }
+    }
+
+    void ConvLayer::save(std::ostream& out) const {
+        out << "[Conv2D, " << in_channels << ", " << in_height << ", " << in_width << ", "
+            << out_channels << ", " << kernel_size << ", " << stride << ", " << padding << ", "
+            << activation_name(activation);
+        for (double b : biases) out << ", " << b;
+        for (double w : weights) out << ", " << w;
+        out << "]";
+    }
+
+    SpatialLayer* ConvLayer::clone() const {
+        ConvLayer* copy = new ConvLayer(in_channels, in_height, in_width, out_channels,
+            kernel_size, stride, padding, activation, false);
+        copy->weights = weights;
+        copy->biases = biases;
+        copy->tuning = tuning;
+        return copy;
+    }
+
+    bool ConvLayer::copy_parameters_to(SpatialLayer& target) const {
+        ConvLayer* copy = dynamic_cast<ConvLayer*>(&target);
+        if (!copy || copy->in_channels != in_channels || copy->in_height != in_height || copy->in_width != in_width
+            || copy->out_channels != out_channels || copy->kernel_size != kernel_size || copy->stride != stride
+            || copy->padding != padding) {
+            return false;
+        }
+        copy->activation = activation;
+        copy->weights.assign(weights.begin(), weights.end());
+        copy->biases.assign(biases.begin(), biases.end());
+        copy->tuning = tuning;
+        return true;
+    }
+
+    PoolLayer::PoolLayer(PoolType type, int channels, int in_height_, int in_width_, int window_, int stride_)
+        : pool_type(type), window(window_), stride(stride_)
+    {
+        if (channels <= 0 || in_height_ <= 0 || in_width_ <= 0 || window_ <= 0 || stride_ <= 0) {
+            throw std::invalid_argument("Pooling dimensions must be positive.");
+        }
+        if (in_height_ < window_ || in_width_ < window_) {
+            throw std::invalid_argument("Pooling window is larger than the input.");
+        }
+
+        in_channels = out_channels = channels;
+        in_height = in_height_;
+        in_width = in_width_;
+        out_height = (in_height - window) / stride + 1;
+        out_width = (in_width - window) / stride + 1;
+    }
+
+    void PoolLayer::forward(const double* in, double* out, int* arg) const {
+        size_t o = 0;
+        for (int c = 0; c < in_channels; ++c) {
+            const double* plane = in + static_cast<size_t>(c) * in_height * in_width;
+            for (int oy = 0; oy < out_height; ++oy) {
+                for (int ox = 0; ox < out_width; ++ox, ++o) {
+                    double best = -std::numeric_limits<double>::infinity();
+                    double sum = 0.0;
+                    int best_index = 0;
+                    for (int wy = 0; wy < window; ++wy) {
+                        int row = (oy * stride + wy) * in_width;
+                        for (int wx = 0; wx < window; ++wx) {
+                            int index = row + ox * stride + wx;
+                            double v = plane[index];
+                            sum += v;
+                            if (v > best) { best = v; best_index = index; }
+                        }
+                    }
+
+                    if (pool_type == PoolType::Max) {
+                        out[o] = best;
+                        if (arg) arg[o] = c * in_height * in_width + best_index;
+                    }
+                    else {
+                        out[o] = sum / (window * window);
+                    }
+                }
+            }
+        }
+    }
+
+    const std::vector<double>& PoolLayer::activate(const std::vector<double>& inputs) {
+        if (inputs.size() != input_size()) {
+            throw std::invalid_argument("Input size does not match pooling input shape.");
+        }
+
+        outputs.resize(output_size());
+        argmax.resize(pool_type == PoolType::Max ? output_size() : 0);
+        forward(inputs.data(), outputs.data(), argmax.empty() ? nullptr : argmax.data());
+        return outputs;
+    }
+
+    void PoolLayer::infer(const double* inputs, double* out) const {
+        forward(inputs, out, nullptr);
+    }
+
+    std::vector<double> PoolLayer::backpropagate(const std::vector<double>& deltas, double) {
+        if (deltas.size() != output_size()) {
+            throw std::invalid_argument("Delta size does not match pooling output shape.");
+        }
+
+        std::vector<double> input_deltas(input_size(), 0.0);
+        if (pool_type == PoolType::Max) {
+            for (size_t o = 0; o < deltas.size(); ++o) input_deltas[argmax[o]] += deltas[o];
+            return input_deltas;
+        }
+
+        double share = 1.0 / (window * window);
+        size_t o = 0;
+        for (int c = 0; c < in_channels; ++c) {
+            double* plane = input_deltas.data() + static_cast<size_t>(c) * in_height * in_width;
+            for (int oy = 0; oy < out_height; ++oy) {
+                for (int ox = 0; ox < out_width; ++ox, ++o) {
+                    for (int wy = 0; wy < window; ++wy) {
+                        for (int wx = 0; wx < window; ++wx) {
+                            plane[(oy * stride + wy) * in_width + ox * stride + wx] += deltas[o] * share;
+                        }
+                    }
+                }
+            }
+        }
+        return input_deltas;
+    }
+
+    void PoolLayer::print_parameters(bool) const {
+        std::cout << (pool_type == PoolType::Max ? "MaxPool " : "AvgPool ")
+            << in_channels << "x" << in_height << "x" << in_width
+            << " -> " << out_channels << "x" << out_height << "x" << out_width
+            << " (window " << window << ", stride " << stride << ")\n";
+    }
+
+    void PoolLayer::save(std::ostream& out) const {
+        out << "[Pool2D, " << (pool_type == PoolType::Max ? "Max" : "Average") << ", "
+            << in_channels << ", " << in_height << ", " << in_width << ", "
+            << window << ", " << stride << "]";
+    }
+
+    SpatialLayer* PoolLayer::clone() const {
+        return new PoolLayer(pool_type, in_channels, in_height, in_width, window, stride);
+    }
+
+    bool PoolLayer::copy_parameters_to(SpatialLayer& target) const {
+        // No parameters; a matching shape is all there is to copy
+        const PoolLayer* copy = dynamic_cast<const PoolLayer*>(&target);
+        return copy && copy->pool_type == pool_type && copy->in_channels == in_channels
+            && copy->in_height == in_height && copy->in_width == in_width
+            && copy->window == window && copy->stride == stride;
+    }
+
+    SpatialLayer* load_spatial_layer(const std::string& line) {
+        size_t begin = line.find('[');
+        size_t end = line.find(']', begin);
+        if (begin == std::string::npos || end == std::string::npos) return nullptr;
+
+        std::string kind, label;
+        std::vector<double> values;
+        try {
+            values = parse_numbers(line.substr(begin + 1, end - begin - 1), kind, label);
+
+            if (kind == "Conv2D") {
+                if (values.size() < 7) return nullptr;
+                ConvLayer* conv = new ConvLayer(
+                    static_cast<int>(values[0]), static_cast<int>(values[1]), static_cast<int>(values[2]),
+                    static_cast<int>(values[3]), static_cast<int>(values[4]), static_cast<int>(values[5]),
+                    static_cast<int>(values[6]), activation_from_name(label));
+
+                size_t expected = 7 + conv->biases.size() + conv->weights.size();
+                if (values.size() != expected) {
+                    delete conv;
+                    return nullptr;
+                }
+                std::copy(values.begin() + 7, values.begin() + 7 + conv->biases.size(), conv->biases.begin());
+                std::copy(values.begin() + 7 + conv->biases.size(), values.end(), conv->weights.begin());
+                return conv;
+            }
+
+            if (kind == "Pool2D") {
+                if (values.size() != 5) return nullptr;
+                PoolType type = label == "Max" ? PoolType::Max : PoolType::Average;
+                return new PoolLayer(type, static_cast<int>(values[0]), static_cast<int>(values[1]),
+                    static_cast<int>(values[2]), static_cast<int>(values[3]), static_cast<int>(values[4]));
+            }
+        }
+        catch (const std::exception&) {
+            return nullptr;
+        }
+
+        return nullptr;
+    }
+
+} // namespace nn
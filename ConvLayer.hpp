@@ -0,0 +1,146 @@
+#pragma once
+
+#include "Node.hpp"
+#include "Optimizer.hpp"
+#include <vector>
+#include <string>
+#include <ostream>
+
+namespace nn {
+
+    enum class PoolType {
+        Max,
+        Average
+    };
+
+    // Layers that work on (channels, height, width) images stored channel-major in a flat vector.
+    // They sit in front of the dense layers of a Net and feed them their flattened output.
+    class SpatialLayer {
+    public:
+        virtual ~SpatialLayer() = default;
+
+        int in_channels = 0, in_height = 0, in_width = 0;
+        int out_channels = 0, out_height = 0, out_width = 0;
+
+        size_t input_size() const;
+        size_t output_size() const;
+
+        // Training forward pass, keeps whatever the backward pass needs.
+        virtual const std::vector<double>& activate(const std::vector<double>& inputs) = 0;
+
+        // Takes the deltas of this layer's outputs (same sign convention as Node: target - output),
+        // updates the parameters and returns the deltas of this layer's inputs.
+        virtual std::vector<double> backpropagate(const std::vector<double>& deltas, double learning_rate) = 0;
+
+        // Stateless forward pass, safe to call from several threads at once.
+        virtual void infer(const double* inputs, double* outputs) const = 0;
+
+        // Same result on the calling thread only, with caller-owned scratch of scratch_size() doubles,
+        // for callers that already give each sample its own thread and must not allocate.
+        virtual void infer_serial(const double* inputs, double* outputs, double* scratch) const;
+        virtual size_t scratch_size() const { return 0; }
+
+        // Layers without parameters ignore this.
+        virtual void set_optimizer(const Optimizer*) {}
+
+        virtual void print_parameters(bool verbose = true) const = 0;
+
+        // One line of a .snn file, wrapped in [] so it is told apart from dense node tuples.
+        virtual void save(std::ostream& out) const = 0;
+
+        // Copy of the shape and parameters only, without training caches or optimizer state.
+        virtual SpatialLayer* clone() const = 0;
+
+        // Overwrites the parameters of an earlier clone() in place, reusing its buffers. Returns false,
+        // leaving target untouched, if it is not a layer of the same kind and shape.
+        virtual bool copy_parameters_to(SpatialLayer& target) const = 0;
+
+        const std::vector<double>& get_outputs() const;
+
+    protected:
+        std::vector<double> outputs;
+    };
+
+    // Kernel knobs of a ConvLayer, set by hand or by autotune. A block_k x block_n tile of the im2col
+    // matrix stays in cache while every output channel of a thread's range streams over it; the
+    // defaults (64 x 256 doubles = 128 KB) suit a typical L2.
+    struct ConvTuning {
+        size_t block_k = 64;
+        size_t block_n = 256;
+        size_t threads = 0;             // forward pass; 0 means one per hardware thread
+        size_t backward_threads = 0;    // backpropagate, timed separately since its loops differ
+    };
+
+    class ConvLayer : public SpatialLayer {
+    public:
+        ConvLayer(int in_channels, int in_height, int in_width, int out_channels,
+            int kernel_size, int stride, int padding, ActivationFunction activation_function);
+
+        int kernel_size;
+        int stride;
+        int padding;
+        ActivationFunction activation;
+
+        // out_channels x (in_channels * kernel_size * kernel_size), row-major.
+        std::vector<double> weights;
+        std::vector<double> biases;
+
+        // Not saved with the weights.
+        ConvTuning tuning;
+
+        const std::vector<double>& activate(const std::vector<double>& inputs) override;
+        std::vector<double> backpropagate(const std::vector<double>& deltas, double learning_rate) override;
+        void infer(const double* inputs, double* outputs) const override;
+        void infer_serial(const double* inputs, double* outputs, double* scratch) const override;
+        size_t scratch_size() const override;
+        void set_optimizer(const Optimizer* optimizer) override;
+        void print_parameters(bool verbose = true) const override;
+        void save(std::ostream& out) const override;
+        SpatialLayer* clone() const override;
+        bool copy_parameters_to(SpatialLayer& target) const override;
+
+    private:
+        // Shape only: weights are left empty unless initialize is set.
+        ConvLayer(int in_channels, int in_height, int in_width, int out_channels,
+            int kernel_size, int stride, int padding, ActivationFunction activation_function, bool initialize);
+
+        size_t patch_size() const;
+        void im2col(const double* image, double* columns) const;
+        void col2im(const double* columns, double* image) const;
+        void forward(const double* inputs, double* columns, double* pre_activation, double* out, size_t threads) const;
+
+        std::vector<double> columns;
+        std::vector<double> pre_activation;
+
+        // One (patch_size + 1)-long block per slot and output channel, laid out like Layer's buffer.
+        const Optimizer* optimizer = nullptr;
+        std::vector<double> optimizer_state;
+        long long update_count = 0;
+    };
+
+    class PoolLayer : public SpatialLayer {
+    public:
+        PoolLayer(PoolType type, int channels, int in_height, int in_width, int window, int stride);
+
+        PoolType pool_type;
+        int window;
+        int stride;
+
+        const std::vector<double>& activate(const std::vector<double>& inputs) override;
+        std::vector<double> backpropagate(const std::vector<double>& deltas, double learning_rate) override;
+        void infer(const double* inputs, double* outputs) const override;
+        void print_parameters(bool verbose = true) const override;
+        void save(std::ostream& out) const override;
+        SpatialLayer* clone() const override;
+        bool copy_parameters_to(SpatialLayer& target) const override;
+
+    private:
+        void forward(const double* inputs, double* out, int* argmax) const;
+
+        std::vector<int> argmax;
+    };
+
+    // Parses a bracketed .snn line written by SpatialLayer::save. Returns nullptr on malformed input.
+    SpatialLayer* load_spatial_layer(const std::string& line);
+
+} // namespace nn
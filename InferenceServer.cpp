@@ -0,0 +1,366 @@
+#include "InferenceServer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <sstream>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace nn {
+
+    InferenceServer::InferenceServer(const Net& net_, const ServerOptions& options_)
+        : net(&net_), handle(nullptr), options(options_), started(std::chrono::steady_clock::now())
+    {
+        if (options.max_batch_size == 0) {
+            throw std::invalid_argument("max_batch_size must be at least 1.");
+        }
+        latencies_ms.reserve(options.latency_window);
+        batcher = std::thread(&InferenceServer::run, this);
+    }
+
+    InferenceServer::InferenceServer(ModelHandle& handle_, const ServerOptions& options_)
+        : net(nullptr), handle(&handle_), options(options_), started(std::chrono::steady_clock::now())
+    {
+        if (options.max_batch_size == 0) {
+            throw std::invalid_argument("max_batch_size must be at least 1.");
+        }
+        latencies_ms.reserve(options.latency_window);
+        batcher = std::thread(&InferenceServer::run, this);
+    }
+
+    InferenceServer::~InferenceServer() {
+        stop();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        queue_ready.notify_all();
+        batcher.join();
+    }
+
+    void InferenceServer::submit(std::vector<double> inputs, Callback done) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!stopping) {
+                queue.push_back(Request{ std::move(inputs), std::move(done), std::chrono::steady_clock::now() });
+                queue_ready.notify_one();
+                return;
+            }
+        }
+        done({}, "server is shutting down");
+    }
+
+    void InferenceServer::run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        std::vector<Request> batch;
+        while (true) {
+            queue_ready.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (queue.empty()) break;
+
+            // Hold the batch open until it is full or its oldest request runs out of patience
+            std::chrono::steady_clock::time_point deadline = queue.front().enqueued + options.max_wait;
+            queue_ready.wait_until(lock, deadline, [this]() {
+                return stopping || queue.size() >= options.max_batch_size;
+            });
+
+            size_t count = std::min(queue.size(), options.max_batch_size);
+            batch.clear();
+            for (size_t i = 0; i < count; ++i) {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+            in_flight += count;
+
+            lock.unlock();
+            run_batch(batch);
+            lock.lock();
+
+            in_flight -= count;
+            if (queue.empty() && in_flight == 0) queue_empty.notify_all();
+        }
+    }
+
+    void InferenceServer::run_batch(std::vector<Request>& batch) {
+        if (handle) {
+            ModelHandle::Reader model = handle->acquire();
+            answer_batch(batch, model.get());
+        }
+        else answer_batch(batch, net);
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const Request& request : batch) {
+            double ms = std::chrono::duration<double, std::milli>(now - request.enqueued).count();
+            if (latencies_ms.size() < options.latency_window) latencies_ms.push_back(ms);
+            else if (!latencies_ms.empty()) {
+                latencies_ms[latency_next] = ms;
+                latency_next = (latency_next + 1) % latencies_ms.size();
+            }
+        }
+        completed += batch.size();
+        ++batch_count;
+    }
+
+    void InferenceServer::answer_batch(std::vector<Request>& batch, const Net* model) {
+        if (!model) {
+            for (Request& request : batch) request.done({}, "no model loaded");
+            return;
+        }
+
+        const size_t input_size = model->get_input_size();
+        const size_t output_size = model->get_output_size();
+
+        std::vector<Request*> valid;
+        std::vector<double> inputs;
+        inputs.reserve(batch.size() * input_size);
+        for (Request& request : batch) {
+            if (request.inputs.size() != input_size) {
+                request.done({}, "expected " + std::to_string(input_size) + " inputs, got "
+                    + std::to_string(request.inputs.size()));
+                continue;
+            }
+            valid.push_back(&request);
+            inputs.insert(inputs.end(), request.inputs.begin(), request.inputs.end());
+        }
+
+        if (!valid.empty()) {
+            std::vector<double> outputs;
+            std::string error;
+            try {
+                model->infer_batch(inputs, valid.size(), outputs);
+            }
+            catch (const std::exception& e) {
+                error = e.what();
+            }
+
+            std::vector<double> row;
+            for (size_t i = 0; i < valid.size(); ++i) {
+                if (error.empty()) {
+                    row.assign(outputs.begin() + i * output_size, outputs.begin() + (i + 1) * output_size);
+                }
+                valid[i]->done(row, error);
+            }
+        }
+    }
+
+    ServerMetrics InferenceServer::get_metrics() const {
+        std::vector<double> sorted;
+        ServerMetrics metrics;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            sorted = latencies_ms;
+            metrics.requests = completed;
+            metrics.batches = batch_count;
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        metrics.mean_batch_size = metrics.batches ? double(metrics.requests) / metrics.batches : 0.0;
+        metrics.requests_per_second = seconds > 0.0 ? metrics.requests / seconds : 0.0;
+
+        if (!sorted.empty()) {
+            std::sort(sorted.begin(), sorted.end());
+            metrics.p50_latency_ms = sorted[(sorted.size() - 1) * 50 / 100];
+            metrics.p99_latency_ms = sorted[(sorted.size() - 1) * 99 / 100];
+        }
+        return metrics;
+    }
+
+    std::string InferenceServer::format_metrics() const {
+        ServerMetrics metrics = get_metrics();
+        std::ostringstream out;
+        out << "stats requests=" << metrics.requests << " batches=" << metrics.batches
+            << " mean_batch=" << metrics.mean_batch_size << " p50_ms=" << metrics.p50_latency_ms
+            << " p99_ms=" << metrics.p99_latency_ms << " rps=" << metrics.requests_per_second;
+        return out.str();
+    }
+
+    void InferenceServer::handle_line(const std::string& line, const std::function<void(const std::string&)>& reply) {
+        std::istringstream ss(line);
+        std::string id;
+        if (!(ss >> id)) return;
+
+        if (id == "stats") {
+            reply(format_metrics());
+            return;
+        }
+
+        std::vector<double> inputs;
+        double value;
+        while (ss >> value) inputs.push_back(value);
+        if (!ss.eof()) {
+            reply(id + " error malformed request");
+            return;
+        }
+
+        submit(std::move(inputs), [id, reply](const std::vector<double>& outputs, const std::string& error) {
+            std::ostringstream out;
+            out.precision(std::numeric_limits<double>::max_digits10);
+            out << id;
+            if (!error.empty()) out << " error " << error;
+            else for (double y : outputs) out << " " << y;
+            reply(out.str());
+        });
+    }
+
+    void InferenceServer::serve_stream(std::istream& in, std::ostream& out) {
+        std::mutex out_mutex;
+        auto reply = [&out, &out_mutex](const std::string& text) {
+            std::lock_guard<std::mutex> lock(out_mutex);
+            out << text << "\n";
+            out.flush();
+        };
+
+        std::string line;
+        while (std::getline(in, line)) {
+            handle_line(line, reply);
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        queue_empty.wait(lock, [this]() { return queue.empty() && in_flight == 0; });
+    }
+
+#ifndef _WIN32
+
+    namespace {
+
+        // Closes the socket once the reader and every pending reply are done with it.
+        struct Connection {
+            int fd;
+            std::mutex write_mutex;
+
+            explicit Connection(int fd_) : fd(fd_) {}
+            ~Connection() { ::close(fd); }
+
+            void send_line(const std::string& text) {
+                std::lock_guard<std::mutex> lock(write_mutex);
+                std::string data = text + "\n";
+                size_t offset = 0;
+                while (offset < data.size()) {
+                    ssize_t sent = ::send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+                    if (sent < 0) {
+                        if (errno == EINTR) continue;
+                        return;
+                    }
+                    offset += static_cast<size_t>(sent);
+                }
+            }
+        };
+
+    }
+
+    bool InferenceServer::serve_unix_socket(const std::string& path) {
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path)) {
+            std::cerr << "Socket path too long: " << path << "\n";
+            return false;
+        }
+        address.sun_family = AF_UNIX;
+        std::strcpy(address.sun_path, path.c_str());
+
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            std::cerr << "Could not create socket: " << std::strerror(errno) << "\n";
+            return false;
+        }
+        ::unlink(path.c_str());
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 64) != 0) {
+            std::cerr << "Could not listen on " << path << ": " << std::strerror(errno) << "\n";
+            ::close(fd);
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            listen_fd = fd;
+            // A stop() that came before the listener existed still counts
+            if (stop_requested) ::shutdown(fd, SHUT_RDWR);
+        }
+
+        struct Reader {
+            std::thread thread;
+            std::weak_ptr<Connection> connection;
+            std::shared_ptr<std::atomic<bool>> finished;
+        };
+        std::vector<Reader> readers;
+
+        while (true) {
+            int client = ::accept(fd, nullptr, nullptr);
+            if (client < 0) {
+                if (errno == EINTR) continue;
+                break; // stop() shut the listener down
+            }
+
+            // Join readers whose clients have hung up
+            for (size_t i = 0; i < readers.size();) {
+                if (readers[i].finished->load()) {
+                    readers[i].thread.join();
+                    readers.erase(readers.begin() + i);
+                }
+                else ++i;
+            }
+
+            std::shared_ptr<Connection> connection = std::make_shared<Connection>(client);
+            std::shared_ptr<std::atomic<bool>> finished = std::make_shared<std::atomic<bool>>(false);
+            std::thread thread([this, connection, finished]() {
+                auto reply = [connection](const std::string& text) { connection->send_line(text); };
+                std::string pending;
+                char buffer[4096];
+                while (true) {
+                    ssize_t received = ::recv(connection->fd, buffer, sizeof(buffer), 0);
+                    if (received < 0 && errno == EINTR) continue;
+                    if (received <= 0) break;
+
+                    pending.append(buffer, static_cast<size_t>(received));
+                    size_t newline;
+                    while ((newline = pending.find('\n')) != std::string::npos) {
+                        std::string line = pending.substr(0, newline);
+                        pending.erase(0, newline + 1);
+                        if (!line.empty() && line.back() == '\r') line.pop_back();
+                        handle_line(line, reply);
+                    }
+                }
+                finished->store(true);
+            });
+            readers.push_back(Reader{ std::move(thread), connection, finished });
+        }
+
+        // Wake readers still blocked on their clients
+        for (Reader& reader : readers) {
+            if (std::shared_ptr<Connection> connection = reader.connection.lock()) ::shutdown(connection->fd, SHUT_RD);
+        }
+        for (Reader& reader : readers) reader.thread.join();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            listen_fd = -1;
+        }
+        ::close(fd);
+        ::unlink(path.c_str());
+        return true;
+    }
+
+    void InferenceServer::stop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop_requested = true;
+        if (listen_fd >= 0) ::shutdown(listen_fd, SHUT_RDWR);
+    }
+
+#else
+
+    bool InferenceServer::serve_unix_socket(const std::string&) {
+        std::cerr << "Unix domain sockets are not supported on this platform; use serve_stream instead.\n";
+        return false;
+    }
+
+    void InferenceServer::stop() {}
+
+#endif
+
+}
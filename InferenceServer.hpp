@@ -0,0 +1,107 @@
+#pragma once
+
+#include "ModelHandle.hpp"
+#include "Net.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nn {
+
+    struct ServerOptions {
+        size_t max_batch_size = 32;
+        // How long the oldest queued request may wait for others to join its batch.
+        std::chrono::microseconds max_wait = std::chrono::microseconds(2000);
+        // Latencies kept for the percentile figures.
+        size_t latency_window = 10000;
+    };
+
+    struct ServerMetrics {
+        size_t requests = 0;
+        size_t batches = 0;
+        double mean_batch_size = 0.0;
+        double p50_latency_ms = 0.0;
+        double p99_latency_ms = 0.0;
+        double requests_per_second = 0.0;
+    };
+
+    // Queues inference requests and answers them in batches with one Net::infer_batch call each.
+    // A batch is run once max_batch_size requests are waiting or the oldest has waited max_wait.
+    //
+    // The Net is only read, but it must not be trained or reloaded while the server is running.
+    //
+    // Line protocol used by serve_stream and serve_unix_socket, one request per line:
+    //   "<id> <x1> <x2> ... <xn>"  ->  "<id> <y1> ... <ym>"  or  "<id> error <message>"
+    //   "stats"                    ->  "stats requests=... batches=... mean_batch=... p50_ms=... p99_ms=... rps=..."
+    // Replies may come back in a different order than the requests; the id ties them together.
+    class InferenceServer {
+    public:
+        using Callback = std::function<void(const std::vector<double>& outputs, const std::string& error)>;
+
+        InferenceServer(const Net& net, const ServerOptions& options = ServerOptions());
+        // Serves whatever model is published on the handle. Each batch pins one model for its whole
+        // run, so a swap never mixes weights within a batch and never stalls the batcher.
+        InferenceServer(ModelHandle& handle, const ServerOptions& options = ServerOptions());
+        ~InferenceServer();
+
+        InferenceServer(const InferenceServer&) = delete;
+        InferenceServer& operator=(const InferenceServer&) = delete;
+
+        // Thread-safe. done runs on the batching thread, with an empty error on success.
+        void submit(std::vector<double> inputs, Callback done);
+
+        // Serves requests from in until end of input, then waits for the outstanding replies.
+        void serve_stream(std::istream& in, std::ostream& out);
+
+        // Listens on a Unix domain socket until stop() is called. Returns false if the socket
+        // cannot be set up (or on platforms without Unix sockets).
+        bool serve_unix_socket(const std::string& path);
+
+        // Ends serve_unix_socket, including one that has not started listening yet: stop() is final,
+        // so a later serve_unix_socket returns as soon as its socket is set up.
+        void stop();
+
+        ServerMetrics get_metrics() const;
+
+    private:
+        struct Request {
+            std::vector<double> inputs;
+            Callback done;
+            std::chrono::steady_clock::time_point enqueued;
+        };
+
+        void run();
+        void run_batch(std::vector<Request>& batch);
+        void answer_batch(std::vector<Request>& batch, const Net* model);
+        void handle_line(const std::string& line, const std::function<void(const std::string&)>& reply);
+        std::string format_metrics() const;
+
+        const Net* net;
+        ModelHandle* handle;
+        ServerOptions options;
+
+        mutable std::mutex mutex;
+        std::condition_variable queue_ready;
+        std::condition_variable queue_empty;
+        std::deque<Request> queue;
+        size_t in_flight = 0;
+        bool stopping = false;
+
+        std::chrono::steady_clock::time_point started;
+        size_t completed = 0;
+        size_t batch_count = 0;
+        std::vector<double> latencies_ms;
+        size_t latency_next = 0;
+
+        int listen_fd = -1;
+        bool stop_requested = false;    // guarded by mutex, like listen_fd
+        std::thread batcher;
+    };
+
+}
@@ -1,6 +1,8 @@
 #include "Layer.hpp"
 #include <iostream> 
 #include <stdexcept>
+#include <algorithm>
+#include <thread>
 
 namespace nn {
 
@@ -23,6 +25,21 @@ namespace nn {
         }
     }
 
+    void Layer::activate(const SparseRow& inputs) {
+        size_t width = get_input_size();
+        for (size_t k = 0; k < inputs.nnz; ++k) {
+            if (inputs.indices[k] < 0 || static_cast<size_t>(inputs.indices[k]) >= width) {
+                throw std::invalid_argument("Sparse input index exceeds number of weights.");
+            }
+        }
+
+        sparse_indices.assign(inputs.indices, inputs.indices + inputs.nnz);
+        sparse_values.assign(inputs.values, inputs.values + inputs.nnz);
+        for (Node& node : nodes) {
+            node.activate_sparse(sparse_indices.data(), sparse_values.data(), inputs.nnz);
+        }
+    }
+
     void Layer::backpropagate(const std::vector<double>& targets, double learning_rate, int saturation_threshold) {
         if (targets.size() != nodes.size()) {
             std::cerr << "Error: Target size = " << targets.size()
@@ -30,6 +47,7 @@ namespace nn {
             throw std::invalid_argument("Target size does not match the number of nodes in the layer.");
         }
 
+        begin_input_deltas();
         for (size_t i = 0; i < nodes.size(); ++i) {
             if (nodes[i].get_node_type() == NodeType::Output) {
                 nodes[i].backpropagate(targets[i], learning_rate, saturation_threshold);
@@ -38,12 +56,26 @@ namespace nn {
                 nodes[i].backpropagate(learning_rate, saturation_threshold);
             }
         }
+        end_input_deltas();
     }
 
     void Layer::backpropagate(double learning_rate, int saturation_threshold) {
+        begin_input_deltas();
         for (Node& node : nodes) {
             node.backpropagate(learning_rate, saturation_threshold);
         }
+        end_input_deltas();
+    }
+
+    void Layer::begin_input_deltas() {
+        if (!keep_input_deltas) return;
+        pending_input_deltas.assign(get_input_size(), 0.0);
+        for (Node& node : nodes) node.set_input_delta_sink(pending_input_deltas.data());
+    }
+
+    void Layer::end_input_deltas() {
+        if (!keep_input_deltas) return;
+        for (Node& node : nodes) node.set_input_delta_sink(nullptr);
     }
 
     void Layer::print_parameters(bool verbose) const {
@@ -67,6 +99,77 @@ namespace nn {
         return outputs;
     }
 
+    size_t Layer::get_input_size() const {
+        return nodes.empty() ? 0 : nodes[0].weights.size();
+    }
+
+    void Layer::infer_batch(const double* inputs, size_t batch, double* outputs) const {
+        const size_t block = std::max<size_t>(1, infer_block);
+        const size_t blocks = (batch + block - 1) / block;
+        const size_t threads = std::min(std::max<size_t>(1, infer_threads), blocks);
+        if (threads <= 1) {
+            infer_rows(inputs, batch, outputs);
+            return;
+        }
+
+        const size_t width = get_input_size();
+        const size_t count = nodes.size();
+        const size_t chunk = (blocks + threads - 1) / threads * block;
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for (size_t begin = chunk; begin < batch; begin += chunk) {
+            size_t rows = std::min(batch, begin + chunk) - begin;
+            workers.emplace_back([=]() { infer_rows(inputs + begin * width, rows, outputs + begin * count); });
+        }
+        infer_rows(inputs, std::min(batch, chunk), outputs);
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    void Layer::infer_rows(const double* inputs, size_t batch, double* outputs) const {
+        // Samples are taken in blocks small enough to stay in cache while every node's weights
+        // stream past them, so each weight row is loaded once per block rather than once per sample.
+        const size_t width = get_input_size();
+        const size_t count = nodes.size();
+        const size_t block = std::max<size_t>(1, infer_block);
+
+        for (size_t b0 = 0; b0 < batch; b0 += block) {
+            size_t b1 = std::min(batch, b0 + block);
+            for (size_t j = 0; j < count; ++j) {
+                const Node& node = nodes[j];
+                const double* w = node.weights.data();
+                ActivationFunction activation = node.get_activation_function();
+                for (size_t b = b0; b < b1; ++b) {
+                    const double* x = inputs + b * width;
+                    double sum = 0.0;
+                    for (size_t i = 0; i < width; ++i) sum += x[i] * w[i];
+                    outputs[b * count + j] = apply_activation_function(activation, sum + node.bias);
+                }
+            }
+        }
+    }
+
+    void Layer::infer_sparse_batch(const SparseTensor& inputs, double* outputs) const {
+        if (inputs.getNumFeatures() != get_input_size()) {
+            throw std::invalid_argument("Sparse input width does not match number of weights.");
+        }
+
+        const size_t count = nodes.size();
+        for (size_t b = 0; b < inputs.getNumSamples(); ++b) {
+            SparseRow row = inputs.getRow(b);
+            for (size_t j = 0; j < count; ++j) {
+                const Node& node = nodes[j];
+                const double* w = node.weights.data();
+                double sum = 0.0;
+                for (size_t k = 0; k < row.nnz; ++k) sum += row.values[k] * w[row.indices[k]];
+                outputs[b * count + j] = apply_activation_function(node.get_activation_function(), sum + node.bias);
+            }
+        }
+    }
+
+    const std::vector<double>& Layer::input_deltas() const {
+        return pending_input_deltas;
+    }
+
     void Layer::connect_nodes(Layer* next_layer) {
         for (Node& source_node : this->nodes) {
             for (Node& target_node : next_layer->nodes) {
@@ -80,6 +183,42 @@ namespace nn {
         this->nodes.push_back(node);
     }
 
+    void Layer::remove_node(size_t index) {
+        if (index >= nodes.size()) throw std::out_of_range("Invalid node index");
+        nodes.erase(nodes.begin() + index);
+    }
+
+    void Layer::remove_input(size_t index) {
+        for (Node& node : nodes) {
+            if (index >= node.weights.size()) throw std::out_of_range("Invalid input index");
+            node.weights.erase(node.weights.begin() + index);
+        }
+    }
+
+    void Layer::release_activations() {
+        for (Node& node : nodes) node.release_activations();
+    }
+
+    size_t Layer::activation_bytes() const {
+        size_t total = sparse_indices.capacity() * sizeof(int) + sparse_values.capacity() * sizeof(double);
+        for (const Node& node : nodes) total += node.activation_bytes();
+        return total;
+    }
+
+    void Layer::set_optimizer(const Optimizer* optimizer) {
+        size_t slots = optimizer ? optimizer->state_slots() : 0;
+
+        size_t total = 0;
+        for (const Node& node : nodes) total += slots * (node.weights.size() + 1);
+        optimizer_state.assign(total, 0.0);
+
+        double* state = optimizer_state.data();
+        for (Node& node : nodes) {
+            node.set_optimizer(optimizer, state);
+            state += slots * (node.weights.size() + 1);
+        }
+    }
+
 
 
 } 
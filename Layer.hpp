@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Node.hpp"
+#include "Tensor.hpp"
 #include <vector>
 #include <string>
 #include <stdexcept>
@@ -14,6 +15,9 @@ namespace nn {
 
         void activate(const std::vector<double>& inputs);
 
+        // Keeps its own copy of the row so the nodes can refer to it during backpropagation.
+        void activate(const SparseRow& inputs);
+
 
         void backpropagate(const std::vector<double>& targets, double learning_rate, int saturation_threshold);
 
@@ -28,15 +32,53 @@ namespace nn {
 
         std::vector<double> get_outputs() const;
 
+        size_t get_input_size() const;
+
+        // Forward pass over batch samples stored row-major in inputs, writing batch x nodes outputs.
+        // Reads the weights only, so several threads may call it on the same layer.
+        void infer_batch(const double* inputs, size_t batch, double* outputs) const;
+        void infer_sparse_batch(const SparseTensor& inputs, double* outputs) const;
+
+        // Deltas for this layer's inputs from the last backward pass, for layers with no Node feeding
+        // them. Computed from the weights the forward pass saw, before the update, and only while
+        // keep_input_deltas is set.
+        const std::vector<double>& input_deltas() const;
+        bool keep_input_deltas = false;
+
         void add_node(Node);
 
+        // Drop a node, or one input column from every node. Connections to neighbouring layers are
+        // left stale; Net::remove_node rebuilds them.
+        void remove_node(size_t index);
+        void remove_input(size_t index);
+
+        void release_activations();
+        size_t activation_bytes() const;
+
+        // Gives every node its slice of one contiguous state buffer for the optimizer; null restores plain SGD.
+        void set_optimizer(const Optimizer* optimizer);
+
         std::vector<Node> nodes;
 
         NodeType layerType;
 
+        // infer_batch knobs, set by hand or by autotune: samples per cache block, and how many threads
+        // share a batch (each gets whole blocks, so small batches stay on the calling thread).
+        size_t infer_block = 16;
+        size_t infer_threads = 1;
+
 
     private:
+        void infer_rows(const double* inputs, size_t batch, double* outputs) const;
+        void begin_input_deltas();
+        void end_input_deltas();
+
         std::string layer_name;
+        std::vector<double> optimizer_state;
+        std::vector<double> pending_input_deltas;
+
+        std::vector<int> sparse_indices;
+        std::vector<double> sparse_values;
     };
 
 } // namespace nn
@@ -0,0 +1,173 @@
+#include "ModelHandle.hpp"
+#include <iostream>
+
+namespace nn {
+
+    ModelHandle::Reader::Reader(ModelHandle* handle_, std::atomic<uint64_t>* slot_, const Net* model_)
+        : handle(handle_), slot(slot_), model(model_) {}
+
+    ModelHandle::Reader::Reader(Reader&& other) noexcept
+        : handle(other.handle), slot(other.slot), model(other.model)
+    {
+        other.handle = nullptr;
+        other.slot = nullptr;
+        other.model = nullptr;
+    }
+
+    ModelHandle::Reader& ModelHandle::Reader::operator=(Reader&& other) noexcept {
+        if (this != &other) {
+            release();
+            handle = other.handle;
+            slot = other.slot;
+            model = other.model;
+            other.handle = nullptr;
+            other.slot = nullptr;
+            other.model = nullptr;
+        }
+        return *this;
+    }
+
+    ModelHandle::Reader::~Reader() {
+        release();
+    }
+
+    void ModelHandle::Reader::release() {
+        if (slot) {
+            // Sequentially consistent on both sides: either a concurrent collect sees this slot idle, or
+            // this load sees the model it retired and collects it here
+            slot->store(0);
+            if (handle->retired_count.load() != 0) handle->collect();
+        }
+        handle = nullptr;
+        slot = nullptr;
+        model = nullptr;
+    }
+
+    ModelHandle::ModelHandle() {}
+
+    ModelHandle::ModelHandle(Net* initial) {
+        current.store(initial);
+        if (initial) version.store(1);
+    }
+
+    ModelHandle::~ModelHandle() {
+        wait_for_load();
+
+        // Any Reader still alive at this point is a caller bug; free everything regardless
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        for (const Retired& old : retired) delete old.net;
+        retired.clear();
+        delete current.load();
+    }
+
+    ModelHandle::Reader ModelHandle::acquire() {
+        // Start the search at a per-thread offset so concurrent readers rarely probe the same slots
+        static std::atomic<size_t> next_thread{ 0 };
+        thread_local size_t start = next_thread++ * 7;
+
+        for (size_t attempt = 0;; ++attempt) {
+            Slot& slot = slots[(start + attempt) % kReaderSlots];
+            uint64_t epoch = global_epoch.load();
+            uint64_t idle = 0;
+            // Announce the epoch before reading the pointer: a writer that retires a model after this
+            // point sees the announcement and leaves the model alone
+            if (slot.epoch.compare_exchange_strong(idle, epoch)) {
+                return Reader(this, &slot.epoch, current.load());
+            }
+            if (attempt % kReaderSlots == kReaderSlots - 1) std::this_thread::yield();
+        }
+    }
+
+    void ModelHandle::publish(Net* net) {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        publish_locked(net);
+    }
+
+    bool ModelHandle::publish_compatible(Net* net, bool allow_shape_change) {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        // current cannot be retired while the writer lock is held, so it is safe to inspect here
+        const Net* old = current.load();
+        if (old && !allow_shape_change
+            && (net->get_input_size() != old->get_input_size() || net->get_output_size() != old->get_output_size())) {
+            std::cerr << "Refusing to publish a model of shape " << net->get_input_size() << " -> "
+                << net->get_output_size() << " over one of shape " << old->get_input_size() << " -> "
+                << old->get_output_size() << "\n";
+            return false;
+        }
+        publish_locked(net);
+        return true;
+    }
+
+    void ModelHandle::publish_locked(Net* net) {
+        const Net* old = current.exchange(net);
+        // Readers announced at or before this epoch may still hold old; later ones cannot
+        uint64_t epoch = global_epoch.fetch_add(1);
+        ++version;
+        if (old) {
+            retired.push_back(Retired{ old, epoch });
+            retired_count.store(retired.size());
+        }
+        collect_locked();
+    }
+
+    void ModelHandle::collect() {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        collect_locked();
+    }
+
+    void ModelHandle::collect_locked() {
+        if (retired.empty()) return;
+
+        uint64_t oldest = UINT64_MAX;
+        for (const Slot& slot : slots) {
+            uint64_t epoch = slot.epoch.load();
+            if (epoch != 0 && epoch < oldest) oldest = epoch;
+        }
+
+        for (size_t i = 0; i < retired.size();) {
+            if (retired[i].epoch < oldest) {
+                delete retired[i].net;
+                retired[i] = retired.back();
+                retired.pop_back();
+            }
+            else ++i;
+        }
+        retired_count.store(retired.size());
+    }
+
+    void ModelHandle::load_async(const std::string& fileName, std::function<void(bool)> done,
+        bool allow_shape_change) {
+        std::lock_guard<std::mutex> lock(loader_mutex);
+        if (loader.joinable()) loader.join();
+
+        loader = std::thread([this, fileName, done, allow_shape_change]() {
+            Net* net = new Net();
+            bool ok = false;
+            try {
+                ok = net->load_net(fileName, false);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Could not load " << fileName << ": " << e.what() << "\n";
+            }
+
+            if (ok) ok = publish_compatible(net, allow_shape_change);
+            if (!ok) delete net;
+            if (done) done(ok);
+        });
+    }
+
+    void ModelHandle::wait_for_load() {
+        std::lock_guard<std::mutex> lock(loader_mutex);
+        if (loader.joinable()) loader.join();
+    }
+
+    uint64_t ModelHandle::get_version() const {
+        return version.load();
+    }
+
+    size_t ModelHandle::get_retired_count() const {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        return retired.size();
+    }
+
+}
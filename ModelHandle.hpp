@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Net.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nn {
+
+    // Shared, swappable model for serving. Readers pin the current Net without taking a lock, a new Net
+    // can be published at any time, and a replaced Net is deleted only once no reader that might still
+    // see it remains (epoch-based reclamation).
+    //
+    //     ModelHandle::Reader model = handle.acquire();
+    //     model->infer_batch(inputs, batch, outputs);
+    //
+    // Published nets are read-only from then on: use infer/infer_batch, never activate or train them.
+    class ModelHandle {
+    public:
+        class Reader {
+        public:
+            Reader(Reader&& other) noexcept;
+            Reader& operator=(Reader&& other) noexcept;
+            Reader(const Reader&) = delete;
+            Reader& operator=(const Reader&) = delete;
+            ~Reader();
+
+            const Net& operator*() const { return *model; }
+            const Net* operator->() const { return model; }
+            const Net* get() const { return model; }
+
+        private:
+            friend class ModelHandle;
+            Reader(ModelHandle* handle, std::atomic<uint64_t>* slot, const Net* model);
+            void release();
+
+            ModelHandle* handle;
+            std::atomic<uint64_t>* slot;
+            const Net* model;
+        };
+
+        ModelHandle();
+        // Takes ownership of initial, which may be null until the first publish.
+        explicit ModelHandle(Net* initial);
+        ~ModelHandle();
+
+        ModelHandle(const ModelHandle&) = delete;
+        ModelHandle& operator=(const ModelHandle&) = delete;
+
+        // Lock-free; may return a reader holding null before anything has been published.
+        Reader acquire();
+
+        // Takes ownership of net and makes it the model for every later acquire. Readers that already
+        // hold the previous model keep using it until they are destroyed.
+        void publish(Net* net);
+
+        // Loads a .snn file on a background thread and publishes it if it parses completely and takes
+        // and returns as many values as the current model; a file that fails either check is dropped
+        // and the current model stays. allow_shape_change skips the size check for deliberate input or
+        // output changes. done, if given, runs on that thread with the outcome. A later call waits for
+        // the previous load to finish.
+        void load_async(const std::string& fileName, std::function<void(bool)> done = nullptr,
+            bool allow_shape_change = false);
+
+        // Blocks until the last load_async has finished.
+        void wait_for_load();
+
+        // Deletes every retired model no reader can still reach. publish does this too, and so does the
+        // release of any reader while a retired model is waiting.
+        void collect();
+
+        uint64_t get_version() const;
+        size_t get_retired_count() const;
+
+    private:
+        static const size_t kReaderSlots = 256;
+
+        // One per cache line so readers on different cores do not contend.
+        struct alignas(64) Slot {
+            std::atomic<uint64_t> epoch{ 0 };
+        };
+
+        struct Retired {
+            const Net* net;
+            uint64_t epoch;
+        };
+
+        void publish_locked(Net* net);
+        bool publish_compatible(Net* net, bool allow_shape_change);
+        void collect_locked();
+
+        Slot slots[kReaderSlots];
+        std::atomic<const Net*> current{ nullptr };
+        std::atomic<uint64_t> global_epoch{ 1 };
+        std::atomic<uint64_t> version{ 0 };
+
+        mutable std::mutex writer_mutex;
+        std::vector<Retired> retired;
+        // retired.size(), readable without the lock so releasing readers only lock when there is work
+        std::atomic<size_t> retired_count{ 0 };
+
+        std::mutex loader_mutex;
+        std::thread loader;
+    };
+
+}
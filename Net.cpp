@@ -4,6 +4,9 @@
 #include <iostream>
 #include <sstream>
 #include <tuple>
+#include <algorithm>
+#include <limits>
+#include <cmath>
 
 
 
@@ -14,9 +17,13 @@ namespace nn {
 	}
 
 	Net::~Net() {
+		for (SpatialLayer* layer : spatial_layers) {
+			delete layer;
+		}
 		for (Layer* layer : layers) {
 			delete layer;
 		}
+		delete optimizer;
 	}
 
 	void Net::add_layer(int numNodes, int inputsPerNode, ActivationFunction activationType, NodeType type) {
@@ -26,12 +33,94 @@ namespace nn {
 		if (!layers.empty()) {
 			layers.back()->connect_nodes(addLayer);
 		}
+		addLayer->set_optimizer(optimizer);
 		layers.push_back(addLayer);
 		numLayers++;
 	}
 
+	void Net::remove_node(size_t layerIndex, size_t nodeIndex) {
+		if (layerIndex + 1 >= layers.size()) {
+			throw std::out_of_range("Only nodes of hidden layers followed by another layer can be removed");
+		}
+		if (layers[layerIndex]->nodes.size() <= 1) {
+			throw std::logic_error("Cannot remove the last node of a layer");
+		}
+
+		layers[layerIndex]->remove_node(nodeIndex);
+		layers[layerIndex + 1]->remove_input(nodeIndex);
+
+		// Node pointers moved with the erase, so wire every layer up again
+		for (Layer* layer : layers) {
+			for (Node& node : layer->nodes) {
+				node.points_to.clear();
+				node.inputs_from.clear();
+				node.inputs.clear();
+				node.back_inputs.clear();
+			}
+		}
+		for (size_t i = 0; i + 1 < layers.size(); ++i) {
+			layers[i]->connect_nodes(layers[i + 1]);
+		}
+		for (Layer* layer : layers) {
+			layer->set_optimizer(optimizer);
+		}
+	}
+
+	void Net::set_optimizer(OptimizerType type, const OptimizerSettings& settings) {
+		Optimizer* replacement = make_optimizer(type, settings);
+		for (SpatialLayer* spatial : spatial_layers) {
+			spatial->set_optimizer(replacement);
+		}
+		for (Layer* layer : layers) {
+			layer->set_optimizer(replacement);
+		}
+		delete optimizer;
+		optimizer = replacement;
+	}
+
+	void Net::add_conv_layer(int inChannels, int inHeight, int inWidth, int outChannels, int kernelSize,
+		int stride, int padding, ActivationFunction activationType) {
+		if (!layers.empty()) {
+			throw std::logic_error("Convolution layers must be added before dense layers.");
+		}
+		if (!spatial_layers.empty()) {
+			const SpatialLayer* previous = spatial_layers.back();
+			if (previous->out_channels != inChannels || previous->out_height != inHeight || previous->out_width != inWidth) {
+				throw std::invalid_argument("Convolution input shape does not match the previous layer's output.");
+			}
+		}
+		ConvLayer* conv = new ConvLayer(inChannels, inHeight, inWidth, outChannels, kernelSize, stride, padding, activationType);
+		conv->set_optimizer(optimizer);
+		spatial_layers.push_back(conv);
+	}
+
+	void Net::add_conv_layer(int outChannels, int kernelSize, int stride, int padding, ActivationFunction activationType) {
+		if (spatial_layers.empty()) {
+			throw std::logic_error("The first convolution layer needs an input shape.");
+		}
+		const SpatialLayer* previous = spatial_layers.back();
+		add_conv_layer(previous->out_channels, previous->out_height, previous->out_width,
+			outChannels, kernelSize, stride, padding, activationType);
+	}
+
+	void Net::add_pool_layer(PoolType type, int window, int stride) {
+		if (!layers.empty()) {
+			throw std::logic_error("Pooling layers must be added before dense layers.");
+		}
+		if (spatial_layers.empty()) {
+			throw std::logic_error("Pooling layers need a convolution layer in front of them.");
+		}
+		const SpatialLayer* previous = spatial_layers.back();
+		spatial_layers.push_back(new PoolLayer(type, previous->out_channels, previous->out_height, previous->out_width, window, stride));
+	}
+
 	void Net::print_parameters(bool verbose) const {
 		std::cout << "Network parameters:\n";
+		for (size_t i = 0; i < spatial_layers.size(); ++i) {
+			std::cout << "Spatial layer " << i << ": ";
+			spatial_layers[i]->print_parameters(verbose);
+			std::cout << "\n";
+		}
 		for (size_t i = 0; i < layers.size(); ++i) {
 			std::cout << "Layer " << i << " (" << layers[i]->get_nodes().size() << " nodes):\n";
 			layers[i]->print_parameters(verbose);
@@ -39,42 +128,80 @@ namespace nn {
 		}
 	}
 
+	void write_snapshot(std::ostream& out, const NetSnapshot& snapshot) {
+		// Enough digits for every weight to read back bit-for-bit
+		std::streamsize oldPrecision = out.precision(std::numeric_limits<double>::max_digits10);
+
+		for (const std::unique_ptr<SpatialLayer>& spatial : snapshot.spatial_layers) {
+			spatial->save(out);
+			out << "\n";
+		}
+
+		for (size_t layerIndex = 0; layerIndex < snapshot.layers.size(); ++layerIndex) {
+			const NetSnapshot::DenseLayer& layer = snapshot.layers[layerIndex];
+
+			for (size_t nodeIndex = 0; nodeIndex < layer.node_names.size(); ++nodeIndex) {
+				out << "(";
+				out << layer.node_names[nodeIndex] << ", ";
+				out << "Layer" << layerIndex << ", ";
+
+				out << activation_name(layer.activations[nodeIndex]);
+
+				out << ", " << layer.biases[nodeIndex];
+
+				for (size_t w = layer.weight_offsets[nodeIndex]; w < layer.weight_offsets[nodeIndex + 1]; ++w) {
+					out << ", " << layer.weights[w];
+				}
+
+				out << ")";
+				if (nodeIndex != layer.node_names.size() - 1) {
+					out << " ";
+				}
+			}
+			out << "\n";
+		}
+
+		out.precision(oldPrecision);
+	}
+
+	void Net::snapshot(NetSnapshot& out) const {
+		out.spatial_layers.resize(spatial_layers.size());
+		for (size_t i = 0; i < spatial_layers.size(); ++i) {
+			std::unique_ptr<SpatialLayer>& copy = out.spatial_layers[i];
+			if (!copy || !spatial_layers[i]->copy_parameters_to(*copy)) copy.reset(spatial_layers[i]->clone());
+		}
+
+		out.layers.resize(layers.size());
+		for (size_t layerIndex = 0; layerIndex < layers.size(); ++layerIndex) {
+			const std::vector<Node>& nodes = layers[layerIndex]->get_nodes();
+			NetSnapshot::DenseLayer& copy = out.layers[layerIndex];
+
+			copy.node_names.resize(nodes.size());
+			copy.activations.resize(nodes.size());
+			copy.biases.resize(nodes.size());
+			copy.weight_offsets.resize(nodes.size() + 1);
+			copy.weight_offsets[0] = 0;
+			for (size_t i = 0; i < nodes.size(); ++i) {
+				copy.weight_offsets[i + 1] = copy.weight_offsets[i] + nodes[i].weights.size();
+			}
+
+			copy.weights.resize(copy.weight_offsets.back());
+			for (size_t i = 0; i < nodes.size(); ++i) {
+				copy.node_names[i] = nodes[i].get_node_name();
+				copy.activations[i] = nodes[i].get_activation_function();
+				copy.biases[i] = nodes[i].bias;
+				std::copy(nodes[i].weights.begin(), nodes[i].weights.end(), copy.weights.begin() + copy.weight_offsets[i]);
+			}
+		}
+	}
+
 	void Net::save_net(const std::string& fileName) const {
 		std::ofstream outFile(fileName + ".snn");
 
 		if (outFile.is_open()) {
-			for (size_t layerIndex = 0; layerIndex < layers.size(); ++layerIndex) {
-				const Layer* layer = layers[layerIndex];
-
-				for (size_t nodeIndex = 0; nodeIndex < layer->get_nodes().size(); ++nodeIndex) {
-					const Node& node = layer->get_nodes()[nodeIndex];
-
-					outFile << "(";
-					outFile << node.get_node_name() << ", ";
-					outFile << "Layer" << layerIndex << ", ";
-
-					switch (node.get_activation_function()) {
-					case ActivationFunction::Sigmoid: outFile << "Sigmoid"; break;
-					case ActivationFunction::ReLU: outFile << "ReLU"; break;
-					case ActivationFunction::Tanh: outFile << "Tanh"; break;
-					case ActivationFunction::LeakyReLU: outFile << "LeakyReLU"; break;
-					case ActivationFunction::Step: outFile << "Step"; break;
-					default: outFile << "Unknown"; break;
-					}
-
-					outFile << ", " << node.bias;
-
-					for (double weight : node.get_weights()) {
-						outFile << ", " << weight;
-					}
-
-					outFile << ")";
-					if (nodeIndex != layer->get_nodes().size() - 1) {
-						outFile << " ";
-					}
-				}
-				outFile << "\n";
-			}
+			NetSnapshot copy;
+			snapshot(copy);
+			write_snapshot(outFile, copy);
 
 			outFile.close();
 			std::cout << "Network saved to " << fileName << ".snn\n";
@@ -85,18 +212,22 @@ namespace nn {
 	}
 
 
-	void Net::load_net(const std::string& fileName) {
+	bool Net::load_net(const std::string& fileName, bool verbose) {
 		if (!(fileName.size() >= 4 && fileName.substr(fileName.length() - 4) == ".snn")) {
 			std::cerr << "Incorrect file suffix, should be .snn\n";
-			return;
+			return false;
 		}
 		std::ifstream inputFile(fileName);
 		if (!inputFile.is_open()) {
 			std::cerr << "Error: Could not open file." << std::endl;
-			return;
+			return false;
 		}
 
 		// Clear existing layers
+		for (SpatialLayer* layer : spatial_layers) {
+			delete layer;
+		}
+		spatial_layers.clear();
 		for (Layer* layer : layers) {
 			delete layer;
 		}
@@ -105,14 +236,33 @@ namespace nn {
 
 		std::string line;
 		int layerIndex = 0;
+		bool complete = true;
 		while (std::getline(inputFile, line)) {
+			// Convolution and pooling layers are stored as [...] lines ahead of the dense layers
+			if (!line.empty() && line[0] == '[') {
+				SpatialLayer* spatial = load_spatial_layer(line);
+				if (!spatial) {
+					std::cerr << "Error: Could not parse spatial layer: " << line << "\n";
+					complete = false;
+					continue;
+				}
+				spatial->set_optimizer(optimizer);
+				spatial_layers.push_back(spatial);
+				continue;
+			}
+
 			std::vector<std::tuple<std::string, ActivationFunction, double, std::vector<double>>> nodeDataList;
 
 			// Parse each node in the line
 			size_t pos = 0;
 			while ((pos = line.find('(')) != std::string::npos) {
 				size_t end = line.find(')', pos);
-				if (end == std::string::npos) break;
+				if (end == std::string::npos) {
+					// A node cut off mid-way, usually a truncated file
+					std::cerr << "Error: Unterminated node in layer " << layerIndex << "\n";
+					complete = false;
+					break;
+				}
 
 				std::string nodeStr = line.substr(pos + 1, end - pos - 1);
 				line = line.substr(end + 1);  // Trim parsed part
@@ -132,13 +282,7 @@ namespace nn {
 				std::string actStr = token;
 				actStr.erase(remove_if(actStr.begin(), actStr.end(), ::isspace), actStr.end());
 
-				ActivationFunction af;
-				if (actStr == "Sigmoid") af = ActivationFunction::Sigmoid;
-				else if (actStr == "ReLU") af = ActivationFunction::ReLU;
-				else if (actStr == "Tanh") af = ActivationFunction::Tanh;
-				else if (actStr == "LeakyReLU") af = ActivationFunction::LeakyReLU;
-				else if (actStr == "Step") af = ActivationFunction::Step;
-				else af = ActivationFunction::Sigmoid; // fallback default
+				ActivationFunction af = activation_from_name(actStr);
 
 				// 4. Bias
 				std::getline(ss, token, ',');
@@ -182,6 +326,7 @@ namespace nn {
 				if (!layers.empty()) {
 					layers.back()->connect_nodes(newLayer);
 				}
+				newLayer->set_optimizer(optimizer);
 
 				layers.push_back(newLayer);
 				layerIndex++;
@@ -189,7 +334,31 @@ namespace nn {
 		}
 
 		numLayers = static_cast<int>(layers.size());
-		std::cout << "Network loaded from " << fileName << "\n";
+
+		// Every layer must take exactly what the one before it produces
+		for (size_t i = 1; i < spatial_layers.size(); ++i) {
+			if (spatial_layers[i]->input_size() != spatial_layers[i - 1]->output_size()) complete = false;
+		}
+		if (!spatial_layers.empty() && !layers.empty()
+			&& layers.front()->get_input_size() != spatial_layers.back()->output_size()) {
+			complete = false;
+		}
+		for (size_t i = 1; i < layers.size(); ++i) {
+			if (layers[i]->get_input_size() != layers[i - 1]->get_nodes().size()) complete = false;
+		}
+		for (const Layer* layer : layers) {
+			for (const Node& node : layer->get_nodes()) {
+				if (node.weights.size() != layer->get_input_size()) complete = false;
+			}
+		}
+		if (layers.empty()) complete = false;
+
+		if (!complete) {
+			std::cerr << "Error: " << fileName << " is incomplete or inconsistent\n";
+			return false;
+		}
+		if (verbose) std::cout << "Network loaded from " << fileName << "\n";
+		return true;
 	}
 
 	void nn::Net::activate(const std::vector<double>& inputs) {
@@ -204,10 +373,176 @@ namespace nn {
 
 		std::vector<double> current_inputs = inputs;
 
-		for (Layer* layer : layers) {
-			layer->activate(current_inputs);
-			current_inputs = layer->get_outputs();
+		for (SpatialLayer* spatial : spatial_layers) {
+			current_inputs = spatial->activate(current_inputs);
+		}
+
+		sparse_forward = false;
+		activate_dense_layers(0, std::move(current_inputs));
+	}
+
+	size_t Net::checkpoint_stride() const {
+		if (checkpoint_interval == kSqrtCheckpoints) {
+			return static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(layers.size()))));
+		}
+		return static_cast<size_t>(checkpoint_interval);
+	}
+
+	void Net::activate_dense_layers(size_t first, std::vector<double> current_inputs) {
+		size_t stride = checkpoint_stride();
+		size_t lastSegment = stride ? ((layers.size() - 1) / stride) * stride : 0;
+		if (stride) checkpoint_inputs.resize(layers.size());
+
+		for (size_t i = first; i < layers.size(); ++i) {
+			if (stride && i % stride == 0) {
+				checkpoint_inputs[i] = current_inputs;
+			}
+
+			layers[i]->activate(current_inputs);
+			current_inputs = layers[i]->get_outputs();
+
+			// The last segment is backpropagated straight away, everything before it is recomputed
+			if (stride && i < lastSegment) {
+				layers[i]->release_activations();
+			}
+		}
+
+		record_activation_memory(true);
+	}
+
+	void Net::recompute_segment(size_t begin, size_t end) {
+		std::vector<double> current_inputs;
+		size_t i = begin;
+		if (begin == 0 && sparse_forward) {
+			// A sparse first layer keeps its own copy of the row and no per-node caches
+			current_inputs = layers[0]->get_outputs();
+			i = 1;
+		}
+		else {
+			current_inputs = checkpoint_inputs[begin];
+		}
+
+		for (; i < end; ++i) {
+			layers[i]->activate(current_inputs);
+			current_inputs = layers[i]->get_outputs();
+			++memory_report.recomputed_layers;
+		}
+
+		record_activation_memory(false);
+	}
+
+	void Net::record_activation_memory(bool after_forward) {
+		size_t total = 0;
+		for (const Layer* layer : layers) total += layer->activation_bytes();
+		for (const std::vector<double>& checkpoint : checkpoint_inputs) total += checkpoint.capacity() * sizeof(double);
+
+		if (after_forward) memory_report.last_forward_bytes = total;
+		memory_report.peak_bytes = std::max(memory_report.peak_bytes, total);
+	}
+
+	void Net::set_gradient_checkpointing(int interval) {
+		if (interval < 0 && interval != kSqrtCheckpoints) {
+			throw std::invalid_argument("Checkpoint interval must be positive, 0 or kSqrtCheckpoints.");
+		}
+		checkpoint_interval = interval;
+		std::vector<std::vector<double>>().swap(checkpoint_inputs);
+	}
+
+	const ActivationMemoryReport& Net::get_memory_report() const {
+		return memory_report;
+	}
+
+	void Net::reset_memory_report() {
+		memory_report = ActivationMemoryReport();
+	}
+
+	void Net::activate(const SparseRow& inputs) {
+		if (layers.empty()) {
+			throw std::runtime_error("Cannot activate an empty network.");
+		}
+		if (!spatial_layers.empty()) {
+			throw std::logic_error("Sparse inputs cannot feed convolution layers.");
+		}
+
+		const Layer* lastLayer = layers.back();
+		if (lastLayer->layerType == NodeType::Hidden) {
+			throw std::runtime_error("Cannot activate without output layer as last layer");
+		}
+
+		layers.front()->activate(inputs);
+		sparse_forward = true;
+		activate_dense_layers(1, layers.front()->get_outputs());
+	}
+
+	size_t Net::get_input_size() const {
+		if (!spatial_layers.empty()) return spatial_layers.front()->input_size();
+		return layers.empty() ? 0 : layers.front()->get_input_size();
+	}
+
+	size_t Net::get_output_size() const {
+		return layers.empty() ? 0 : layers.back()->get_nodes().size();
+	}
+
+	void Net::infer_batch(const std::vector<double>& inputs, size_t batch, std::vector<double>& outputs) const {
+		if (layers.empty()) {
+			throw std::runtime_error("Cannot activate an empty network.");
+		}
+		if (inputs.size() != batch * get_input_size()) {
+			throw std::invalid_argument("Input batch size does not match the network's input size.");
+		}
+
+		std::vector<double> current(inputs);
+		std::vector<double> next;
+
+		for (const SpatialLayer* spatial : spatial_layers) {
+			next.resize(batch * spatial->output_size());
+			for (size_t b = 0; b < batch; ++b) {
+				spatial->infer(current.data() + b * spatial->input_size(), next.data() + b * spatial->output_size());
+			}
+			current.swap(next);
+		}
+
+		for (const Layer* layer : layers) {
+			if (current.size() != batch * layer->get_input_size()) {
+				throw std::invalid_argument("Layer input size does not match the previous layer's output.");
+			}
+			next.resize(batch * layer->get_nodes().size());
+			layer->infer_batch(current.data(), batch, next.data());
+			current.swap(next);
+		}
+
+		outputs.swap(current);
+	}
+
+	void Net::infer_sparse_batch(const SparseTensor& inputs, std::vector<double>& outputs) const {
+		if (layers.empty()) {
+			throw std::runtime_error("Cannot activate an empty network.");
+		}
+		if (!spatial_layers.empty()) {
+			throw std::logic_error("Sparse inputs cannot feed convolution layers.");
+		}
+
+		size_t batch = inputs.getNumSamples();
+		std::vector<double> current(batch * layers.front()->get_nodes().size());
+		layers.front()->infer_sparse_batch(inputs, current.data());
+
+		std::vector<double> next;
+		for (size_t i = 1; i < layers.size(); ++i) {
+			if (current.size() != batch * layers[i]->get_input_size()) {
+				throw std::invalid_argument("Layer input size does not match the previous layer's output.");
+			}
+			next.resize(batch * layers[i]->get_nodes().size());
+			layers[i]->infer_batch(current.data(), batch, next.data());
+			current.swap(next);
 		}
+
+		outputs.swap(current);
+	}
+
+	std::vector<double> Net::infer(const std::vector<double>& inputs) const {
+		std::vector<double> outputs;
+		infer_batch(inputs, 1, outputs);
+		return outputs;
 	}
 
 	void nn::Net::backpropagate(const std::vector<double>& targets, double learning_rate, int saturation_threshold) {
@@ -220,13 +555,46 @@ namespace nn {
 			throw std::runtime_error("Cannot backpropogate without output layer as last layer");
 		}
 
-		// Backpropagate output layer
-		Layer* output_layer = layers.back();
-		output_layer->backpropagate(targets, learning_rate, saturation_threshold);
+		// The spatial layers need the first dense layer's input deltas, taken before its update
+		layers.front()->keep_input_deltas = !spatial_layers.empty();
+
+		size_t stride = checkpoint_stride();
+		if (stride == 0) {
+			// Backpropagate output layer
+			Layer* output_layer = layers.back();
+			output_layer->backpropagate(targets, learning_rate, saturation_threshold);
+
+			// Backpropagate hidden layers in reverse order
+			for (int i = static_cast<int>(layers.size()) - 2; i >= 0; --i) {
+				layers[i]->backpropagate(learning_rate, saturation_threshold);
+			}
+		}
+		else {
+			// Walk the segments back to front; weights of a segment only change after it has been
+			// recomputed, so the recomputed caches match the original forward pass exactly
+			size_t lastSegment = ((layers.size() - 1) / stride) * stride;
+			for (size_t begin = lastSegment + stride; begin >= stride;) {
+				begin -= stride;
+				size_t end = std::min(begin + stride, layers.size());
+				if (begin != lastSegment) recompute_segment(begin, end);
+
+				for (size_t i = end; i-- > begin;) {
+					if (i == layers.size() - 1) layers[i]->backpropagate(targets, learning_rate, saturation_threshold);
+					else layers[i]->backpropagate(learning_rate, saturation_threshold);
+				}
+
+				if (begin != lastSegment) {
+					for (size_t i = begin; i <= end && i < layers.size(); ++i) layers[i]->release_activations();
+				}
+			}
+		}
 
-		// Backpropagate hidden layers in reverse order
-		for (int i = static_cast<int>(layers.size()) - 2; i >= 0; --i) {
-			layers[i]->backpropagate(learning_rate, saturation_threshold);
+		// The first dense layer has no Node inputs, so hand its deltas to the spatial layers directly
+		if (!spatial_layers.empty()) {
+			std::vector<double> deltas = layers.front()->input_deltas();
+			for (int i = static_cast<int>(spatial_layers.size()) - 1; i >= 0; --i) {
+				deltas = spatial_layers[i]->backpropagate(deltas, learning_rate);
+			}
 		}
 	}
 
@@ -1,15 +1,46 @@
 #pragma once
 
 #include "Layer.hpp"
+#include "ConvLayer.hpp"
 #include "Tensor.hpp"
+#include "Optimizer.hpp"
 #include <vector>
 #include <string>
 #include <stdexcept>
 #include <fstream>
+#include <memory>
+#include <ostream>
 
 
 namespace nn {
 
+	// Memory held for the backward pass by the dense layers: every node's cached inputs plus any
+	// stored checkpoints. Spatial layers are not counted.
+	struct ActivationMemoryReport {
+		size_t peak_bytes = 0;
+		size_t last_forward_bytes = 0;
+		size_t recomputed_layers = 0;
+	};
+
+	// Plain copy of a Net's parameters, enough to write a .snn file without touching the Net again.
+	// Filling an existing snapshot reuses its buffers, spatial layers included, so repeated snapshots
+	// of one Net do not allocate; only the first one, or one after the topology changed, does.
+	struct NetSnapshot {
+		struct DenseLayer {
+			std::vector<std::string> node_names;
+			std::vector<ActivationFunction> activations;
+			std::vector<double> biases;
+			std::vector<size_t> weight_offsets; // node i owns weights[weight_offsets[i], weight_offsets[i + 1])
+			std::vector<double> weights;
+		};
+
+		std::vector<std::unique_ptr<SpatialLayer>> spatial_layers;
+		std::vector<DenseLayer> layers;
+	};
+
+	// Writes the .snn text for a snapshot; Net::save_net goes through this as well.
+	void write_snapshot(std::ostream& out, const NetSnapshot& snapshot);
+
 	class Net {
 
 	public:
@@ -23,6 +54,13 @@ namespace nn {
 
 		void add_layer(int numNodes, int inputsPerNode, ActivationFunction activationType, NodeType type);
 
+		// Convolution and pooling layers run before the dense layers, which see their flattened output.
+		// The first spatial layer needs the input image shape, later ones take it from the layer before.
+		void add_conv_layer(int inChannels, int inHeight, int inWidth, int outChannels, int kernelSize,
+			int stride, int padding, ActivationFunction activationType);
+		void add_conv_layer(int outChannels, int kernelSize, int stride, int padding, ActivationFunction activationType);
+		void add_pool_layer(PoolType type, int window, int stride);
+
 		Layer* get_layer(size_t index) {
 			if (index >= layers.size()) throw std::out_of_range("Invalid layer index");
 			return layers[index];
@@ -30,19 +68,69 @@ namespace nn {
 
 		void print_parameters(bool verbose = true) const;
 
+		// Removes a hidden node together with the weights that read its output in the next layer.
+		// Optimizer state is reset for the whole net.
+		void remove_node(size_t layerIndex, size_t nodeIndex);
+
+		// Switches every layer, including ones added or loaded later, to the given update rule.
+		// Optimizer state starts from zero each time this is called.
+		void set_optimizer(OptimizerType type, const OptimizerSettings& settings = OptimizerSettings());
+
 
 		std::vector<Layer*> layers;
+		std::vector<SpatialLayer*> spatial_layers;
+
+		Optimizer* optimizer = nullptr;
+
 
 
 		void save_net(const std::string& fileName) const;
 
-		void load_net(const std::string& fileName);
+		void snapshot(NetSnapshot& out) const;
+
+		// verbose=false skips the progress line on stdout, for loaders running beside a live process.
+		// Returns false if the file cannot be read, a line does not parse or the layer sizes do not
+		// chain up (e.g. a truncated file); the net then holds whatever was read and must not be used.
+		bool load_net(const std::string& fileName, bool verbose = true);
 
 		void activate(const std::vector<double>& inputs);
-		void backpropagate(const std::vector<double>& targets, double learning_rate, int saturation_threshold);
 
+		// Sparse input for the first dense layer; only the weights of non-zero columns are read here and
+		// updated by the next backpropagate. Not available in front of convolution layers.
+		void activate(const SparseRow& inputs);
 
+		// Inference without touching any training state, so many threads can share one Net as long as
+		// nobody trains or reloads it meanwhile. inputs holds batch samples row-major; outputs is resized
+		// to batch x get_output_size().
+		void infer_batch(const std::vector<double>& inputs, size_t batch, std::vector<double>& outputs) const;
+		std::vector<double> infer(const std::vector<double>& inputs) const;
+		void infer_sparse_batch(const SparseTensor& inputs, std::vector<double>& outputs) const;
+
+		size_t get_input_size() const;
+		size_t get_output_size() const;
+
+		void backpropagate(const std::vector<double>& targets, double learning_rate, int saturation_threshold);
 
+		// Gradient checkpointing for the dense layers. With an interval k > 0 the forward pass keeps only
+		// the input of every k-th layer and drops the per-node input caches of all but the last segment;
+		// backpropagate recomputes one segment at a time from its checkpoint. Larger k stores fewer
+		// checkpoints but holds a longer segment at once; kSqrtCheckpoints picks k = ceil(sqrt(layers)),
+		// 0 turns it off. Results are identical either way.
+		static const int kSqrtCheckpoints = -1;
+		void set_gradient_checkpointing(int interval);
+		const ActivationMemoryReport& get_memory_report() const;
+		void reset_memory_report();
+
+	private:
+		size_t checkpoint_stride() const;
+		void activate_dense_layers(size_t first, std::vector<double> current_inputs);
+		void recompute_segment(size_t begin, size_t end);
+		void record_activation_memory(bool after_forward);
+
+		int checkpoint_interval = 0;
+		bool sparse_forward = false;
+		std::vector<std::vector<double>> checkpoint_inputs;
+		ActivationMemoryReport memory_report;
 	};
 
 };
@@ -44,6 +44,48 @@ namespace nn {
         std::cerr << "Warning: Step function has no usable derivative.\n";
     }
 
+    double apply_activation_function(ActivationFunction activation, double x) {
+        switch (activation) {
+        case ActivationFunction::Sigmoid: return sigmoid(x);
+        case ActivationFunction::ReLU: return relu(x);
+        case ActivationFunction::Tanh: return tanh_activation(x);
+        case ActivationFunction::LeakyReLU: return leaky_relu(x);
+        case ActivationFunction::Step: return step(x);
+        default: throw std::runtime_error("Unknown activation function.");
+        }
+    }
+
+    double activation_function_derivative(ActivationFunction activation, double x) {
+        switch (activation) {
+        case ActivationFunction::Sigmoid: return sigmoid_derivative(x);
+        case ActivationFunction::ReLU: return relu_derivative(x);
+        case ActivationFunction::Tanh: return tanh_derivative(x);
+        case ActivationFunction::LeakyReLU: return leaky_relu_derivative(x);
+        case ActivationFunction::Step: warn_step_derivative(); return 0.0;
+        default: throw std::runtime_error("Unknown activation function (derivative).");
+        }
+    }
+
+    const char* activation_name(ActivationFunction activation) {
+        switch (activation) {
+        case ActivationFunction::Sigmoid: return "Sigmoid";
+        case ActivationFunction::ReLU: return "ReLU";
+        case ActivationFunction::Tanh: return "Tanh";
+        case ActivationFunction::LeakyReLU: return "LeakyReLU";
+        case ActivationFunction::Step: return "Step";
+        default: return "Unknown";
+        }
+    }
+
+    ActivationFunction activation_from_name(const std::string& name) {
+        if (name == "Sigmoid") return ActivationFunction::Sigmoid;
+        if (name == "ReLU") return ActivationFunction::ReLU;
+        if (name == "Tanh") return ActivationFunction::Tanh;
+        if (name == "LeakyReLU") return ActivationFunction::LeakyReLU;
+        if (name == "Step") return ActivationFunction::Step;
+        return ActivationFunction::Sigmoid; // fallback default
+    }
+
     Node::Node(int num_inputs, ActivationFunction activation_input, const std::string& layer,
         const std::string& name, NodeType type)
         : activation(activation_input), layer_name(layer), node_name(name), node_type(type)
@@ -65,10 +107,6 @@ namespace nn {
         }
     }
 
-    Node::~Node() {
-        std::cout << "Destroying Node: " << node_name << " in " << layer_name << "\n";
-    }
-
     void Node::point_node(std::vector<Node*> node_vector) {
         points_to = node_vector;
         for (Node* n : node_vector) n->inputs_from.push_back(this);
@@ -90,25 +128,11 @@ namespace nn {
     std::vector<double> Node::get_weights() const { return weights; }
 
     double Node::apply_activation(double x) const {
-        switch (activation) {
-        case ActivationFunction::Sigmoid: return sigmoid(x);
-        case ActivationFunction::ReLU: return relu(x);
-        case ActivationFunction::Tanh: return tanh_activation(x);
-        case ActivationFunction::LeakyReLU: return leaky_relu(x);
-        case ActivationFunction::Step: return step(x);
-        default: throw std::runtime_error("Unknown activation function.");
-        }
+        return apply_activation_function(activation, x);
     }
 
     double Node::activation_derivative(double x) const {
-        switch (activation) {
-        case ActivationFunction::Sigmoid: return sigmoid_derivative(x);
-        case ActivationFunction::ReLU: return relu_derivative(x);
-        case ActivationFunction::Tanh: return tanh_derivative(x);
-        case ActivationFunction::LeakyReLU: return leaky_relu_derivative(x);
-        case ActivationFunction::Step: warn_step_derivative(); return 0.0;
-        default: throw std::runtime_error("Unknown activation function (derivative).");
-        }
+        return activation_function_derivative(activation, x);
     }
 
     double Node::activate() {
@@ -117,6 +141,7 @@ namespace nn {
         }
 
         inputs_snapshot = inputs;
+        sparse_input = false;
         double sum = 0.0;
         for (size_t i = 0; i < inputs.size(); ++i) sum += inputs[i] * weights[i];
         sum += bias;
@@ -136,6 +161,55 @@ namespace nn {
         return activate();
     }
 
+    double Node::activate_sparse(const int* indices, const double* values, size_t nnz) {
+        sparse_input = true;
+        sparse_indices = indices;
+        sparse_values = values;
+        sparse_count = nnz;
+        inputs_snapshot.clear();
+
+        double sum = 0.0;
+        for (size_t k = 0; k < nnz; ++k) sum += values[k] * weights[indices[k]];
+        sum += bias;
+
+        last_input_sum = sum;
+        last_output = apply_activation(sum);
+
+        for (Node* n : points_to) n->inputs.push_back(last_output);
+        return last_output;
+    }
+
+    void Node::update_parameters(double learning_rate) {
+        if (sparse_input) {
+            if (optimizer) {
+                optimizer->step_sparse(weights.data(), sparse_indices, sparse_values, sparse_count, last_delta,
+                    bias, last_delta, optimizer_state, weights.size(), learning_rate, ++update_count);
+                return;
+            }
+
+            for (size_t k = 0; k < sparse_count; ++k) {
+                weights[sparse_indices[k]] += learning_rate * last_delta * sparse_values[k];
+            }
+            bias += learning_rate * last_delta;
+            return;
+        }
+
+        if (inputs_snapshot.size() != weights.size()) {
+            throw std::logic_error("Node has no cached inputs; activate it before backpropagating.");
+        }
+
+        if (optimizer) {
+            optimizer->step(weights.data(), inputs_snapshot.data(), last_delta, bias, last_delta,
+                optimizer_state, weights.size(), learning_rate, ++update_count);
+            return;
+        }
+
+        for (size_t i = 0; i < weights.size(); ++i) {
+            weights[i] += learning_rate * last_delta * inputs_snapshot[i];
+        }
+        bias += learning_rate * last_delta;
+    }
+
     void Node::backpropagate(double target, double learning_rate, int saturation_threshold) {
         if (node_type != NodeType::Output) {
             throw std::logic_error("Only output nodes should receive targets.");
@@ -152,10 +226,10 @@ namespace nn {
         }
         else saturation_count = 0;
 
-        for (size_t i = 0; i < weights.size(); ++i) {
-            weights[i] += learning_rate * last_delta * inputs_snapshot[i]; // ← FIXED
+        if (input_delta_sink) {
+            for (size_t i = 0; i < weights.size(); ++i) input_delta_sink[i] += last_delta * weights[i];
         }
-        bias += learning_rate * last_delta;
+        update_parameters(learning_rate);
 
         for (size_t i = 0; i < inputs_from.size(); ++i) {
             inputs_from[i]->back_inputs.push_back(last_delta * weights[i]);
@@ -179,10 +253,10 @@ namespace nn {
         }
         else saturation_count = 0;
 
-        for (size_t i = 0; i < weights.size(); ++i) {
-            weights[i] += learning_rate * last_delta * inputs_snapshot[i];
+        if (input_delta_sink) {
+            for (size_t i = 0; i < weights.size(); ++i) input_delta_sink[i] += last_delta * weights[i];
         }
-        bias += learning_rate * last_delta;
+        update_parameters(learning_rate);
 
         for (size_t i = 0; i < inputs_from.size(); ++i) {
             inputs_from[i]->back_inputs.push_back(last_delta * weights[i]);
@@ -227,5 +301,24 @@ namespace nn {
         bias = b;
     }
 
+    void Node::set_optimizer(const Optimizer* opt, double* state) {
+        optimizer = opt;
+        optimizer_state = state;
+        update_count = 0;
+    }
+
+    void Node::set_input_delta_sink(double* sink) {
+        input_delta_sink = sink;
+    }
+
+    void Node::release_activations() {
+        std::vector<double>().swap(inputs);
+        std::vector<double>().swap(inputs_snapshot);
+    }
+
+    size_t Node::activation_bytes() const {
+        return (inputs.capacity() + inputs_snapshot.capacity() + back_inputs.capacity()) * sizeof(double);
+    }
+
 
 }
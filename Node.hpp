@@ -7,6 +7,7 @@
 #include <cmath>
 #include <stdexcept>
 #include <iomanip>
+#include "Optimizer.hpp"
 
 namespace nn {
 
@@ -34,6 +35,11 @@ namespace nn {
     double step(double x);
     void warn_step_derivative();
 
+    double apply_activation_function(ActivationFunction activation, double x);
+    double activation_function_derivative(ActivationFunction activation, double x);
+    const char* activation_name(ActivationFunction activation);
+    ActivationFunction activation_from_name(const std::string& name);
+
     class Node {
     private:
         ActivationFunction activation;
@@ -50,8 +56,23 @@ namespace nn {
 
         std::vector<double> inputs_snapshot;
 
+        // Set by activate_sparse in place of inputs_snapshot; the arrays belong to the caller.
+        bool sparse_input = false;
+        const int* sparse_indices = nullptr;
+        const double* sparse_values = nullptr;
+        size_t sparse_count = 0;
+
+        // Update rule and this node's block of the owning layer's optimizer state; plain SGD when null.
+        const Optimizer* optimizer = nullptr;
+        double* optimizer_state = nullptr;
+        long long update_count = 0;
+
+        // When set, backpropagate adds last_delta * weights here before updating them.
+        double* input_delta_sink = nullptr;
+
         double apply_activation(double x) const;
         double activation_derivative(double x) const;
+        void update_parameters(double learning_rate);
 
     public:
         std::vector<double> weights;
@@ -64,7 +85,6 @@ namespace nn {
 
         Node(int num_inputs, ActivationFunction activation_input, const std::string& layer,
             const std::string& name, NodeType type);
-        ~Node();
 
         void point_node(std::vector<Node*> node_vector);
         void point_node(Node* node);
@@ -76,6 +96,9 @@ namespace nn {
 
         double activate();
         double activate(const std::vector<double>& inputs);
+        // Dot product over the non-zeros only. The arrays must stay alive until backpropagate,
+        // which then updates just the weights at those indices.
+        double activate_sparse(const int* indices, const double* values, size_t nnz);
         void print_parameters() const;
 
         void backpropagate(double target, double learning_rate, int saturation_threshold);
@@ -89,6 +112,12 @@ namespace nn {
         std::vector<double>& get_weights();
         std::string& get_node_name();    
         void set_bias(double b);                 
+        void set_optimizer(const Optimizer* opt, double* state);
+        void set_input_delta_sink(double* sink);
+
+        // Frees the copies of the input vector kept for backpropagation; activate refills them.
+        void release_activations();
+        size_t activation_bytes() const;
 
 
 
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+
+namespace nn {
+
+    enum class OptimizerType {
+        SGD,
+        Momentum,
+        Nesterov,
+        Adam
+    };
+
+    struct OptimizerSettings {
+        double momentum = 0.9;
+        double beta1 = 0.9;
+        double beta2 = 0.999;
+        double epsilon = 1e-8;
+    };
+
+    // Update rule shared by every layer of a Net. The optimizer itself is stateless; each layer owns one
+    // contiguous buffer holding state_slots() blocks of (inputs + 1) doubles per node, the last entry of
+    // every block belonging to the bias.
+    //
+    // Steps follow Node's sign convention: delta is (target - output) scaled by the activation
+    // derivative, so delta * inputs[i] is the direction that lowers the error. A node passes its delta
+    // as bias_delta too; layers that already hold full gradients pass them as inputs with a delta of 1.
+    class Optimizer {
+    public:
+        virtual ~Optimizer() = default;
+
+        virtual OptimizerType get_type() const = 0;
+        virtual size_t state_slots() const = 0;
+
+        // One fused pass: weights[i] move along delta * inputs[i], the bias along bias_delta, and the
+        // optimizer state is updated in place. update_count is how many steps this block has taken, from 1.
+        virtual void step(double* weights, const double* inputs, double delta, double& bias, double bias_delta,
+            double* state, size_t n, double learning_rate, long long update_count) const = 0;
+
+        // Same update for sparse inputs: only the nnz weights at indices move, and only their state
+        // is touched (the "lazy" variant), so the cost follows nnz rather than n.
+        virtual void step_sparse(double* weights, const int* indices, const double* inputs, size_t nnz,
+            double delta, double& bias, double bias_delta, double* state, size_t n,
+            double learning_rate, long long update_count) const = 0;
+    };
+
+    class SGDOptimizer : public Optimizer {
+    public:
+        OptimizerType get_type() const override;
+        size_t state_slots() const override;
+        void step(double* weights, const double* inputs, double delta, double& bias, double bias_delta,
+            double* state, size_t n, double learning_rate, long long update_count) const override;
+        void step_sparse(double* weights, const int* indices, const double* inputs, size_t nnz,
+            double delta, double& bias, double bias_delta, double* state, size_t n,
+            double learning_rate, long long update_count) const override;
+    };
+
+    class MomentumOptimizer : public Optimizer {
+    public:
+        MomentumOptimizer(double momentum, bool nesterov);
+
+        OptimizerType get_type() const override;
+        size_t state_slots() const override;
+        void step(double* weights, const double* inputs, double delta, double& bias, double bias_delta,
+            double* state, size_t n, double learning_rate, long long update_count) const override;
+        void step_sparse(double* weights, const int* indices, const double* inputs, size_t nnz,
+            double delta, double& bias, double bias_delta, double* state, size_t n,
+            double learning_rate, long long update_count) const override;
+
+    private:
+        double momentum;
+        bool nesterov;
+    };
+
+    class AdamOptimizer : public Optimizer {
+    public:
+        AdamOptimizer(double beta1, double beta2, double epsilon);
+
+        OptimizerType get_type() const override;
+        size_t state_slots() const override;
+        void step(double* weights, const double* inputs, double delta, double& bias, double bias_delta,
+            double* state, size_t n, double learning_rate, long long update_count) const override;
+        void step_sparse(double* weights, const int* indices, const double* inputs, size_t nnz,
+            double delta, double& bias, double bias_delta, double* state, size_t n,
+            double learning_rate, long long update_count) const override;
+
+    private:
+        double beta1;
+        double beta2;
+        double epsilon;
+    };
+
+    Optimizer* make_optimizer(OptimizerType type, const OptimizerSettings& settings = OptimizerSettings());
+
+}
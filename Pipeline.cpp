@@ -0,0 +1,221 @@
+#include "Pipeline.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace nn {
+
+    namespace {
+
+        // Spin briefly, then yield, then sleep, so an idle stage does not hold a core forever.
+        void back_off(unsigned& spins) {
+            ++spins;
+            if (spins < 64) return;
+            if (spins < 1024) std::this_thread::yield();
+            else std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+
+        void pin_to_core(std::thread& thread, size_t core) {
+#ifdef __linux__
+            unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(core % cores, &set);
+            pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+            (void)thread;
+            (void)core;
+#endif
+        }
+
+    }
+
+    Pipeline::Pipeline(const Net& net_, Callback done_, const PipelineOptions& options_)
+        : net(net_), done(std::move(done_)), options(options_)
+    {
+        if (!done) throw std::invalid_argument("Pipeline needs a result callback.");
+        if (options.max_in_flight == 0) throw std::invalid_argument("max_in_flight must be at least 1.");
+        if (net.spatial_layers.empty() && net.layers.empty()) {
+            throw std::runtime_error("Cannot build a pipeline for an empty network.");
+        }
+
+        input_size = net.get_input_size();
+        size_t widest = input_size;
+        for (const SpatialLayer* layer : net.spatial_layers) {
+            units.push_back(Unit{ layer, nullptr, layer->output_size() });
+            widest = std::max(widest, layer->output_size());
+            work_size = std::max(work_size, layer->scratch_size());
+        }
+        for (const Layer* layer : net.layers) {
+            units.push_back(Unit{ nullptr, layer, layer->get_nodes().size() });
+            widest = std::max(widest, layer->get_nodes().size());
+        }
+
+        measure_costs(std::max<size_t>(1, options.calibration_runs));
+
+        size_t stages = options.stages ? options.stages : std::max(1u, std::thread::hardware_concurrency());
+        balance(std::min(stages, units.size()));
+
+        // Every sample is preallocated at the widest layer size, with room for the largest spatial
+        // layer's scratch, so the stages never allocate
+        free_samples.reset(new SpscQueue<Sample*>(options.max_in_flight));
+        for (size_t i = 0; i < options.max_in_flight; ++i) {
+            samples.emplace_back(new Sample());
+            samples.back()->current.reserve(widest);
+            samples.back()->scratch.reserve(widest);
+            samples.back()->work.resize(work_size);
+            free_samples->try_push(samples.back().get());
+        }
+        for (size_t s = 0; s < stage_starts.size(); ++s) {
+            queues.emplace_back(new SpscQueue<Sample*>(options.max_in_flight));
+        }
+
+        for (size_t s = 0; s < stage_starts.size(); ++s) {
+            threads.emplace_back(&Pipeline::run_stage, this, s);
+            if (options.pin_threads) pin_to_core(threads.back(), s);
+        }
+    }
+
+    Pipeline::~Pipeline() {
+        stop();
+    }
+
+    void Pipeline::run_unit(const Unit& unit, Sample& sample) const {
+        sample.scratch.resize(unit.output_size);
+        if (unit.spatial) unit.spatial->infer_serial(sample.current.data(), sample.scratch.data(), sample.work.data());
+        else unit.dense->infer_batch(sample.current.data(), 1, sample.scratch.data());
+        sample.current.swap(sample.scratch);
+    }
+
+    void Pipeline::measure_costs(size_t runs) {
+        Sample sample;
+        sample.work.resize(work_size);
+        layer_costs.assign(units.size(), 0.0);
+        for (size_t u = 0; u < units.size(); ++u) {
+            size_t in = u == 0 ? input_size : units[u - 1].output_size;
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (size_t r = 0; r < runs; ++r) {
+                sample.current.assign(in, 0.5);
+                run_unit(units[u], sample);
+            }
+            layer_costs[u] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / runs;
+        }
+    }
+
+    void Pipeline::balance(size_t stages) {
+        // Split the layer costs into `stages` contiguous runs with the smallest possible maximum run
+        size_t n = units.size();
+        std::vector<double> prefix(n + 1, 0.0);
+        for (size_t i = 0; i < n; ++i) prefix[i + 1] = prefix[i] + layer_costs[i];
+
+        const double inf = std::numeric_limits<double>::infinity();
+        // best[k][i]: slowest stage when the first i layers form k stages; cut[k][i]: where the last one starts
+        std::vector<std::vector<double>> best(stages + 1, std::vector<double>(n + 1, inf));
+        std::vector<std::vector<size_t>> cut(stages + 1, std::vector<size_t>(n + 1, 0));
+        best[0][0] = 0.0;
+        for (size_t k = 1; k <= stages; ++k) {
+            for (size_t i = k; i <= n; ++i) {
+                for (size_t j = k - 1; j < i; ++j) {
+                    double slowest = std::max(best[k - 1][j], prefix[i] - prefix[j]);
+                    if (slowest < best[k][i]) {
+                        best[k][i] = slowest;
+                        cut[k][i] = j;
+                    }
+                }
+            }
+        }
+
+        stage_starts.assign(stages, 0);
+        size_t end = n;
+        for (size_t k = stages; k > 0; --k) {
+            stage_starts[k - 1] = cut[k][end];
+            end = cut[k][end];
+        }
+    }
+
+    void Pipeline::run_stage(size_t stage) {
+        SpscQueue<Sample*>& in = *queues[stage];
+        SpscQueue<Sample*>* out = stage + 1 < queues.size() ? queues[stage + 1].get() : nullptr;
+        size_t first = stage_starts[stage];
+        size_t last = stage + 1 < stage_starts.size() ? stage_starts[stage + 1] : units.size();
+
+        unsigned spins = 0;
+        for (;;) {
+            Sample* sample;
+            if (!in.try_pop(sample)) {
+                // stop() flushes first, so an empty queue after stopping means no more work
+                if (stopping.load(std::memory_order_acquire)) return;
+                back_off(spins);
+                continue;
+            }
+            spins = 0;
+
+            for (size_t u = first; u < last; ++u) run_unit(units[u], *sample);
+
+            if (out) {
+                // Never full: each queue holds as many slots as there are samples
+                out->try_push(sample);
+                continue;
+            }
+
+            try {
+                done(sample->id, sample->current);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Pipeline callback failed: " << e.what() << "\n";
+            }
+            free_samples->try_push(sample);
+            delivered.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    uint64_t Pipeline::push(const std::vector<double>& inputs) {
+        if (stopping.load()) throw std::runtime_error("Pipeline has been stopped.");
+        if (inputs.size() != input_size) {
+            throw std::invalid_argument("Expected " + std::to_string(input_size) + " inputs, got "
+                + std::to_string(inputs.size()));
+        }
+
+        Sample* sample;
+        unsigned spins = 0;
+        while (!free_samples->try_pop(sample)) back_off(spins);
+
+        sample->id = next_id++;
+        sample->current.assign(inputs.begin(), inputs.end());
+        queues.front()->try_push(sample);
+        return sample->id;
+    }
+
+    void Pipeline::flush() {
+        unsigned spins = 0;
+        while (delivered.load(std::memory_order_acquire) != next_id) back_off(spins);
+    }
+
+    void Pipeline::stop() {
+        if (threads.empty()) return;
+        flush();
+        stopping.store(true, std::memory_order_release);
+        for (std::thread& thread : threads) thread.join();
+        threads.clear();
+    }
+
+    size_t Pipeline::get_stage_count() const {
+        return stage_starts.size();
+    }
+
+    const std::vector<size_t>& Pipeline::get_stage_starts() const {
+        return stage_starts;
+    }
+
+    const std::vector<double>& Pipeline::get_layer_costs() const {
+        return layer_costs;
+    }
+
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "Net.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace nn {
+
+    // Bounded single-producer, single-consumer ring. One thread may call try_push and one other
+    // thread try_pop; neither ever blocks or locks.
+    template <typename T>
+    class SpscQueue {
+    public:
+        explicit SpscQueue(size_t capacity) : slots(capacity + 1) {}
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        bool try_push(const T& item) {
+            size_t tail = tail_index.load(std::memory_order_relaxed);
+            size_t next = tail + 1 == slots.size() ? 0 : tail + 1;
+            if (next == head_index.load(std::memory_order_acquire)) return false;
+            slots[tail] = item;
+            tail_index.store(next, std::memory_order_release);
+            return true;
+        }
+
+        bool try_pop(T& item) {
+            size_t head = head_index.load(std::memory_order_relaxed);
+            if (head == tail_index.load(std::memory_order_acquire)) return false;
+            item = slots[head];
+            head_index.store(head + 1 == slots.size() ? 0 : head + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        std::vector<T> slots;
+        // Producer and consumer each own one index; keep them on separate cache lines.
+        alignas(64) std::atomic<size_t> head_index{ 0 };
+        alignas(64) std::atomic<size_t> tail_index{ 0 };
+    };
+
+    struct PipelineOptions {
+        size_t stages = 0;              // 0 means one per hardware thread; never more than the net has layers
+        size_t max_in_flight = 64;      // samples inside the pipeline at once
+        size_t calibration_runs = 32;   // timed forward passes per layer used to balance the stages
+        bool pin_threads = false;       // bind stage i to core i (Linux only)
+    };
+
+    // Streams single samples through a Net with its layers split into contiguous stages, each stage
+    // on its own thread, so sample i + 1 runs the early layers while sample i runs the later ones.
+    // Stages are chosen at construction by timing every layer and minimising the slowest stage.
+    // Each stage runs its layers on its own thread only (convolutions never fan out), and all buffers
+    // are allocated up front.
+    //
+    // push and flush must be called from one thread. Results arrive in push order on the last stage's
+    // thread. The Net is only read, so it must not be trained while the pipeline exists.
+    class Pipeline {
+    public:
+        using Callback = std::function<void(uint64_t id, const std::vector<double>& outputs)>;
+
+        Pipeline(const Net& net, Callback done, const PipelineOptions& options = PipelineOptions());
+        ~Pipeline();
+
+        Pipeline(const Pipeline&) = delete;
+        Pipeline& operator=(const Pipeline&) = delete;
+
+        // Returns the id passed to the callback. Waits only when max_in_flight samples are already queued.
+        uint64_t push(const std::vector<double>& inputs);
+
+        // Waits until every pushed sample has been delivered.
+        void flush();
+
+        // Flushes, then ends the stage threads. Later pushes throw.
+        void stop();
+
+        size_t get_stage_count() const;
+        // Index of the first layer of every stage, spatial layers counted before dense ones.
+        const std::vector<size_t>& get_stage_starts() const;
+        // Measured seconds per sample for every layer, in the same order.
+        const std::vector<double>& get_layer_costs() const;
+
+    private:
+        struct Unit {
+            const SpatialLayer* spatial;
+            const Layer* dense;
+            size_t output_size;
+        };
+
+        struct Sample {
+            uint64_t id;
+            std::vector<double> current;
+            std::vector<double> scratch;
+            std::vector<double> work;   // SpatialLayer::infer_serial scratch, sized for the largest layer
+        };
+
+        void run_unit(const Unit& unit, Sample& sample) const;
+        void measure_costs(size_t runs);
+        void balance(size_t stages);
+        void run_stage(size_t stage);
+
+        const Net& net;
+        Callback done;
+        PipelineOptions options;
+        size_t input_size = 0;
+        size_t work_size = 0;
+
+        std::vector<Unit> units;
+        std::vector<double> layer_costs;
+        std::vector<size_t> stage_starts;
+
+        std::vector<std::unique_ptr<Sample>> samples;
+        std::vector<std::unique_ptr<SpscQueue<Sample*>>> queues;    // queues[s] feeds stage s
+        std::unique_ptr<SpscQueue<Sample*>> free_samples;           // last stage back to push
+
+        uint64_t next_id = 0;
+        std::atomic<uint64_t> delivered{ 0 };
+        std::atomic<bool> stopping{ false };
+        std::vector<std::thread> threads;
+    };
+
+}
@@ -0,0 +1,382 @@
+#include "Pruning.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+namespace nn {
+
+    namespace {
+
+        // Magnitude below which the smallest `sparsity` fraction of values falls.
+        double magnitude_threshold(std::vector<double> magnitudes, double sparsity) {
+            if (magnitudes.empty() || sparsity <= 0.0) return 0.0;
+            if (sparsity >= 1.0) return std::numeric_limits<double>::infinity();
+
+            size_t k = static_cast<size_t>(sparsity * magnitudes.size());
+            if (k == 0) return 0.0;
+            std::nth_element(magnitudes.begin(), magnitudes.begin() + (k - 1), magnitudes.end());
+            return std::nextafter(magnitudes[k - 1], std::numeric_limits<double>::infinity());
+        }
+
+        std::vector<double> layer_magnitudes(const Layer& layer) {
+            std::vector<double> magnitudes;
+            for (const Node& node : layer.nodes) {
+                for (double w : node.weights) magnitudes.push_back(std::abs(w));
+            }
+            return magnitudes;
+        }
+
+        std::vector<double> flatten_inputs(const Tensor& data) {
+            std::vector<double> inputs;
+            for (const std::vector<double>& row : data.inputs) inputs.insert(inputs.end(), row.begin(), row.end());
+            return inputs;
+        }
+
+        // Dense against pruned outputs of the same samples, width values per sample.
+        PruneAccuracy compare_outputs(const std::vector<double>& denseOut, const std::vector<double>& sparseOut,
+            size_t width, const Tensor& data) {
+            PruneAccuracy accuracy;
+            size_t samples = data.getNumSamples();
+            if (samples == 0 || width == 0) return accuracy;
+
+            size_t agree = 0, labelled = 0;
+            for (size_t s = 0; s < samples; ++s) {
+                const double* d = denseOut.data() + s * width;
+                const double* p = sparseOut.data() + s * width;
+                for (size_t j = 0; j < width; ++j) {
+                    double diff = std::abs(d[j] - p[j]);
+                    accuracy.mean_abs_diff += diff;
+                    accuracy.max_abs_diff = std::max(accuracy.max_abs_diff, diff);
+                }
+                if (std::max_element(d, d + width) - d == std::max_element(p, p + width) - p) ++agree;
+
+                if (s < data.labels.size() && data.labels[s].size() == width) {
+                    ++labelled;
+                    for (size_t j = 0; j < width; ++j) {
+                        accuracy.dense_mse += (d[j] - data.labels[s][j]) * (d[j] - data.labels[s][j]);
+                        accuracy.sparse_mse += (p[j] - data.labels[s][j]) * (p[j] - data.labels[s][j]);
+                    }
+                }
+            }
+
+            accuracy.mean_abs_diff /= double(samples * width);
+            accuracy.argmax_agreement = double(agree) / samples;
+            if (labelled) {
+                accuracy.dense_mse /= double(labelled * width);
+                accuracy.sparse_mse /= double(labelled * width);
+            }
+            return accuracy;
+        }
+
+        std::string trim(const std::string& text) {
+            size_t begin = text.find_first_not_of(" \t\r\n");
+            if (begin == std::string::npos) return "";
+            size_t end = text.find_last_not_of(" \t\r\n");
+            return text.substr(begin, end - begin + 1);
+        }
+
+    }
+
+    PruneReport prune_net(Net& net, const PruneOptions& options) {
+        PruneReport report;
+        for (const Layer* layer : net.layers) {
+            for (const Node& node : layer->nodes) report.weights_before += node.weights.size();
+        }
+
+        // Structured pass: a node whose outgoing weights are all tiny hardly affects the next layer
+        if (options.node_threshold > 0.0) {
+            for (size_t l = 0; l + 1 < net.layers.size(); ++l) {
+                for (size_t j = net.layers[l]->nodes.size(); j-- > 0;) {
+                    if (net.layers[l]->nodes.size() <= 1) break;
+
+                    double norm = 0.0;
+                    for (const Node& next : net.layers[l + 1]->nodes) norm += next.weights[j] * next.weights[j];
+                    if (std::sqrt(norm) < options.node_threshold) {
+                        net.remove_node(l, j);
+                        ++report.nodes_removed;
+                    }
+                }
+            }
+        }
+
+        std::vector<double> thresholds(net.layers.size());
+        if (options.global) {
+            std::vector<double> all;
+            for (const Layer* layer : net.layers) {
+                std::vector<double> magnitudes = layer_magnitudes(*layer);
+                all.insert(all.end(), magnitudes.begin(), magnitudes.end());
+            }
+            std::fill(thresholds.begin(), thresholds.end(), magnitude_threshold(std::move(all), options.sparsity));
+        }
+        else {
+            for (size_t l = 0; l < net.layers.size(); ++l) {
+                double sparsity = l < options.layer_sparsity.size() ? options.layer_sparsity[l] : options.sparsity;
+                thresholds[l] = magnitude_threshold(layer_magnitudes(*net.layers[l]), sparsity);
+            }
+        }
+
+        for (size_t l = 0; l < net.layers.size(); ++l) {
+            size_t total = 0, kept = 0;
+            for (Node& node : net.layers[l]->nodes) {
+                for (double& w : node.weights) {
+                    if (std::abs(w) < thresholds[l]) w = 0.0;
+                    if (w != 0.0) ++kept;
+                    ++total;
+                }
+            }
+            report.weights_after += kept;
+            report.layer_density.push_back(total ? double(kept) / total : 0.0);
+        }
+
+        return report;
+    }
+
+    PruneReport prune_net(Net& net, const Tensor& data, const PruneOptions& options) {
+        if (data.getNumSamples() == 0) return prune_net(net, options);
+
+        // Only the dense outputs need keeping, not a copy of the net
+        std::vector<double> inputs = flatten_inputs(data);
+        std::vector<double> denseOut, prunedOut;
+        net.infer_batch(inputs, data.getNumSamples(), denseOut);
+
+        PruneReport report = prune_net(net, options);
+        net.infer_batch(inputs, data.getNumSamples(), prunedOut);
+        report.accuracy = compare_outputs(denseOut, prunedOut, net.get_output_size(), data);
+        return report;
+    }
+
+    SparseNet::SparseNet(const Net& net) {
+        for (const SpatialLayer* spatial : net.spatial_layers) {
+            spatial_layers.emplace_back(spatial->clone());
+        }
+
+        for (const Layer* layer : net.layers) {
+            SparseLayer sparse;
+            sparse.inputs = layer->get_input_size();
+            sparse.row_offsets.push_back(0);
+            for (const Node& node : layer->nodes) {
+                sparse.node_names.push_back(node.get_node_name());
+                sparse.activations.push_back(node.get_activation_function());
+                sparse.biases.push_back(node.bias);
+                for (size_t i = 0; i < node.weights.size(); ++i) {
+                    if (node.weights[i] == 0.0) continue;
+                    sparse.column_indices.push_back(static_cast<int>(i));
+                    sparse.values.push_back(node.weights[i]);
+                }
+                sparse.row_offsets.push_back(sparse.values.size());
+            }
+            layers.push_back(std::move(sparse));
+        }
+    }
+
+    void SparseNet::SparseLayer::infer_batch(const double* in, size_t batch, double* out) const {
+        const size_t count = biases.size();
+        const size_t block = 16;
+
+        // Same sample blocking as Layer::infer_batch: each row's non-zeros are read once per block
+        for (size_t b0 = 0; b0 < batch; b0 += block) {
+            size_t b1 = std::min(batch, b0 + block);
+            for (size_t j = 0; j < count; ++j) {
+                const int* columns = column_indices.data() + row_offsets[j];
+                const double* weights = values.data() + row_offsets[j];
+                size_t nnz = row_offsets[j + 1] - row_offsets[j];
+                for (size_t b = b0; b < b1; ++b) {
+                    const double* x = in + b * inputs;
+                    double sum = biases[j];
+                    for (size_t k = 0; k < nnz; ++k) sum += weights[k] * x[columns[k]];
+                    out[b * count + j] = apply_activation_function(activations[j], sum);
+                }
+            }
+        }
+    }
+
+    void SparseNet::infer_batch(const std::vector<double>& inputs, size_t batch, std::vector<double>& outputs) const {
+        if (layers.empty()) {
+            throw std::runtime_error("Cannot activate an empty network.");
+        }
+        if (inputs.size() != batch * get_input_size()) {
+            throw std::invalid_argument("Input batch size does not match the network's input size.");
+        }
+
+        std::vector<double> current(inputs);
+        std::vector<double> next;
+
+        for (const std::unique_ptr<SpatialLayer>& spatial : spatial_layers) {
+            next.resize(batch * spatial->output_size());
+            for (size_t b = 0; b < batch; ++b) {
+                spatial->infer(current.data() + b * spatial->input_size(), next.data() + b * spatial->output_size());
+            }
+            current.swap(next);
+        }
+
+        for (const SparseLayer& layer : layers) {
+            if (current.size() != batch * layer.inputs) {
+                throw std::invalid_argument("Layer input size does not match the previous layer's output.");
+            }
+            next.resize(batch * layer.biases.size());
+            layer.infer_batch(current.data(), batch, next.data());
+            current.swap(next);
+        }
+
+        outputs.swap(current);
+    }
+
+    std::vector<double> SparseNet::infer(const std::vector<double>& inputs) const {
+        std::vector<double> outputs;
+        infer_batch(inputs, 1, outputs);
+        return outputs;
+    }
+
+    size_t SparseNet::get_input_size() const {
+        if (!spatial_layers.empty()) return spatial_layers.front()->input_size();
+        return layers.empty() ? 0 : layers.front().inputs;
+    }
+
+    size_t SparseNet::get_output_size() const {
+        return layers.empty() ? 0 : layers.back().biases.size();
+    }
+
+    size_t SparseNet::get_nonzeros() const {
+        size_t total = 0;
+        for (const SparseLayer& layer : layers) total += layer.values.size();
+        return total;
+    }
+
+    size_t SparseNet::memory_bytes() const {
+        size_t total = 0;
+        for (const SparseLayer& layer : layers) {
+            total += layer.values.size() * (sizeof(double) + sizeof(int))
+                + layer.row_offsets.size() * sizeof(size_t) + layer.biases.size() * sizeof(double);
+        }
+        return total;
+    }
+
+    size_t SparseNet::dense_memory_bytes() const {
+        size_t total = 0;
+        for (const SparseLayer& layer : layers) {
+            total += (layer.inputs + 1) * layer.biases.size() * sizeof(double);
+        }
+        return total;
+    }
+
+    void SparseNet::save(const std::string& fileName) const {
+        std::ofstream outFile(fileName + ".ssnn");
+        if (!outFile.is_open()) {
+            std::cerr << "Error opening Net File!" << std::endl;
+            return;
+        }
+
+        outFile.precision(std::numeric_limits<double>::max_digits10);
+        for (const std::unique_ptr<SpatialLayer>& spatial : spatial_layers) {
+            spatial->save(outFile);
+            outFile << "\n";
+        }
+
+        for (size_t l = 0; l < layers.size(); ++l) {
+            const SparseLayer& layer = layers[l];
+            outFile << "{" << layer.inputs << "}";
+            for (size_t j = 0; j < layer.biases.size(); ++j) {
+                outFile << " (" << layer.node_names[j] << ", Layer" << l << ", "
+                    << activation_name(layer.activations[j]) << ", " << layer.biases[j];
+                for (size_t k = layer.row_offsets[j]; k < layer.row_offsets[j + 1]; ++k) {
+                    outFile << ", " << layer.column_indices[k] << ":" << layer.values[k];
+                }
+                outFile << ")";
+            }
+            outFile << "\n";
+        }
+
+        std::cout << "Sparse network saved to " << fileName << ".ssnn\n";
+    }
+
+    bool SparseNet::load(const std::string& fileName) {
+        if (!(fileName.size() >= 5 && fileName.substr(fileName.length() - 5) == ".ssnn")) {
+            std::cerr << "Incorrect file suffix, should be .ssnn\n";
+            return false;
+        }
+        std::ifstream inputFile(fileName);
+        if (!inputFile.is_open()) {
+            std::cerr << "Error: Could not open file." << std::endl;
+            return false;
+        }
+
+        std::vector<std::unique_ptr<SpatialLayer>> loadedSpatial;
+        std::vector<SparseLayer> loadedLayers;
+
+        std::string line;
+        while (std::getline(inputFile, line)) {
+            if (!line.empty() && line[0] == '[') {
+                SpatialLayer* spatial = load_spatial_layer(line);
+                if (!spatial) {
+                    std::cerr << "Error: Could not parse spatial layer: " << line << "\n";
+                    return false;
+                }
+                loadedSpatial.emplace_back(spatial);
+                continue;
+            }
+            if (line.empty() || line[0] != '{') continue;
+
+            try {
+                SparseLayer layer;
+                size_t close = line.find('}');
+                if (close == std::string::npos) throw std::invalid_argument("missing }");
+                layer.inputs = std::stoul(line.substr(1, close - 1));
+                layer.row_offsets.push_back(0);
+
+                size_t pos = close;
+                while ((pos = line.find('(', pos)) != std::string::npos) {
+                    size_t end = line.find(')', pos);
+                    if (end == std::string::npos) throw std::invalid_argument("missing )");
+
+                    std::istringstream ss(line.substr(pos + 1, end - pos - 1));
+                    pos = end + 1;
+                    std::string token;
+
+                    std::getline(ss, token, ',');
+                    layer.node_names.push_back(trim(token));
+                    std::getline(ss, token, ','); // Layer label
+                    std::getline(ss, token, ',');
+                    layer.activations.push_back(activation_from_name(trim(token)));
+                    std::getline(ss, token, ',');
+                    layer.biases.push_back(std::stod(token));
+
+                    while (std::getline(ss, token, ',')) {
+                        size_t colon = token.find(':');
+                        if (colon == std::string::npos) throw std::invalid_argument("weight without column");
+                        int column = std::stoi(token.substr(0, colon));
+                        if (column < 0 || static_cast<size_t>(column) >= layer.inputs) {
+                            throw std::out_of_range("column out of range");
+                        }
+                        layer.column_indices.push_back(column);
+                        layer.values.push_back(std::stod(token.substr(colon + 1)));
+                    }
+                    layer.row_offsets.push_back(layer.values.size());
+                }
+                loadedLayers.push_back(std::move(layer));
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Error: Could not parse sparse layer (" << e.what() << ")\n";
+                return false;
+            }
+        }
+
+        spatial_layers = std::move(loadedSpatial);
+        layers = std::move(loadedLayers);
+        std::cout << "Sparse network loaded from " << fileName << "\n";
+        return true;
+    }
+
+    PruneAccuracy compare_pruned(const Net& dense, const SparseNet& sparse, const Tensor& data) {
+        if (data.getNumSamples() == 0) return PruneAccuracy();
+
+        std::vector<double> inputs = flatten_inputs(data);
+        std::vector<double> denseOut, sparseOut;
+        dense.infer_batch(inputs, data.getNumSamples(), denseOut);
+        sparse.infer_batch(inputs, data.getNumSamples(), sparseOut);
+        return compare_outputs(denseOut, sparseOut, dense.get_output_size(), data);
+    }
+
+}
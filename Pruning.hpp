@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Net.hpp"
+#include "Tensor.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nn {
+
+    struct PruneOptions {
+        // Fraction of dense weights set to zero. Biases are never pruned.
+        double sparsity = 0.9;
+
+        // One magnitude threshold across every dense layer, or one per layer.
+        bool global = true;
+
+        // Per-layer sparsity overriding `sparsity` when global is off; missing entries use `sparsity`.
+        std::vector<double> layer_sparsity;
+
+        // Structured pruning: hidden nodes whose outgoing weights have an L2 norm below this are
+        // removed outright before magnitude pruning. 0 disables it.
+        double node_threshold = 0.0;
+    };
+
+    struct PruneAccuracy {
+        double mean_abs_diff = 0.0;    // between dense and sparse outputs
+        double max_abs_diff = 0.0;
+        double dense_mse = 0.0;        // against the labels, when the tensor has them
+        double sparse_mse = 0.0;
+        double argmax_agreement = 0.0; // fraction of samples where both pick the same output
+    };
+
+    struct PruneReport {
+        size_t weights_before = 0;
+        size_t weights_after = 0;   // non-zero weights left
+        size_t nodes_removed = 0;
+        std::vector<double> layer_density;
+        PruneAccuracy accuracy;     // filled only when prune_net is given evaluation data
+    };
+
+    // Prunes the dense layers of net in place. Pruned weights are plain zeros, so further training
+    // will move them again; convert to a SparseNet once the net is final.
+    PruneReport prune_net(Net& net, const PruneOptions& options = PruneOptions());
+
+    // As above, and runs data through the net before and after pruning so report.accuracy shows what
+    // pruning cost against the dense original, which no longer exists once this returns.
+    PruneReport prune_net(Net& net, const Tensor& data, const PruneOptions& options = PruneOptions());
+
+    // Inference-only copy of a Net with every dense layer stored in compressed sparse row form, one row
+    // per node. Convolution and pooling layers are kept as they are.
+    //
+    // Saved as a .ssnn file (sparse .snn): any [...] spatial lines as in .snn, then one line per dense
+    // layer, "{<inputs>}" followed by "(<name>, Layer<i>, <activation>, <bias>, <column>:<weight>, ...)"
+    // for each node.
+    class SparseNet {
+    public:
+        SparseNet() = default;
+        explicit SparseNet(const Net& net);
+
+        void infer_batch(const std::vector<double>& inputs, size_t batch, std::vector<double>& outputs) const;
+        std::vector<double> infer(const std::vector<double>& inputs) const;
+
+        size_t get_input_size() const;
+        size_t get_output_size() const;
+        size_t get_nonzeros() const;
+
+        // Bytes held by the weights of the sparse layers, against the same layers stored densely.
+        size_t memory_bytes() const;
+        size_t dense_memory_bytes() const;
+
+        void save(const std::string& fileName) const;
+        bool load(const std::string& fileName);
+
+    private:
+        struct SparseLayer {
+            size_t inputs = 0;
+            std::vector<std::string> node_names;
+            std::vector<ActivationFunction> activations;
+            std::vector<double> biases;
+            std::vector<size_t> row_offsets;
+            std::vector<int> column_indices;
+            std::vector<double> values;
+
+            void infer_batch(const double* in, size_t batch, double* out) const;
+        };
+
+        std::vector<std::unique_ptr<SpatialLayer>> spatial_layers;
+        std::vector<SparseLayer> layers;
+    };
+
+    // Runs both nets over data and reports how far the pruned one strays from the dense original.
+    // prune_net works in place, so dense must be a separate unpruned net, e.g. the .snn saved before
+    // pruning loaded again; prune_net(net, data) reports the same numbers without that round trip.
+    PruneAccuracy compare_pruned(const Net& dense, const SparseNet& sparse, const Tensor& data);
+
+}
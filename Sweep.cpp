@@ -0,0 +1,131 @@
+#include "Sweep.hpp"
+#include <chrono>
+#include <stdexcept>
+
+namespace nn {
+
+    namespace {
+
+        void train_one(const SweepConfig& config, const Tensor& data, SweepResult& result, bool keep_net) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            result.config = config;
+
+            try {
+                if (config.topology.empty()) {
+                    throw std::invalid_argument("Sweep topology needs at least an output layer.");
+                }
+
+                std::unique_ptr<Net> net(new Net());
+                int inputs = static_cast<int>(data.getNumFeatures());
+                for (size_t l = 0; l < config.topology.size(); ++l) {
+                    bool output = l + 1 == config.topology.size();
+                    net->add_layer(config.topology[l], inputs,
+                        output ? config.output_activation : config.hidden_activation,
+                        output ? NodeType::Output : NodeType::Hidden);
+                    inputs = config.topology[l];
+                }
+                net->set_optimizer(config.optimizer);
+
+                for (int epoch = 0; epoch < config.epochs; ++epoch) {
+                    for (size_t i = 0; i < data.inputs.size(); ++i) {
+                        net->activate(data.inputs[i]);
+                        net->backpropagate(data.labels[i], config.learning_rate, config.saturation_threshold);
+                    }
+                }
+
+                std::vector<double> flat;
+                for (const std::vector<double>& row : data.inputs) flat.insert(flat.end(), row.begin(), row.end());
+                std::vector<double> outputs;
+                net->infer_batch(flat, data.getNumSamples(), outputs);
+
+                double loss = 0.0;
+                size_t count = 0;
+                size_t width = net->get_output_size();
+                for (size_t i = 0; i < data.labels.size(); ++i) {
+                    for (size_t j = 0; j < width && j < data.labels[i].size(); ++j) {
+                        double diff = outputs[i * width + j] - data.labels[i][j];
+                        loss += diff * diff;
+                        ++count;
+                    }
+                }
+                result.final_loss = count ? loss / count : 0.0;
+
+                if (keep_net) result.net = std::move(net);
+            }
+            catch (const std::exception& e) {
+                result.error = e.what();
+            }
+
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+    }
+
+    std::vector<SweepResult> run_sweep(const std::vector<SweepConfig>& configs, const Tensor& data,
+        ThreadPool& pool, bool keep_nets) {
+        if (data.inputs.size() != data.labels.size()) {
+            throw std::invalid_argument("Sweep data needs one label per sample.");
+        }
+
+        std::vector<SweepResult> results(configs.size());
+        TaskGroup group(pool);
+        for (size_t i = 0; i < configs.size(); ++i) {
+            const SweepConfig* config = &configs[i];
+            SweepResult* result = &results[i];
+            group.run([config, result, &data, keep_nets]() { train_one(*config, data, *result, keep_nets); });
+        }
+        group.wait();
+        return results;
+    }
+
+    void Ensemble::add_member(const Net* net, double weight) {
+        if (!net) throw std::invalid_argument("Ensemble member cannot be null.");
+        if (!members.empty() && (net->get_input_size() != members[0]->get_input_size()
+            || net->get_output_size() != members[0]->get_output_size())) {
+            throw std::invalid_argument("Ensemble members must share input and output sizes.");
+        }
+        members.push_back(net);
+        weights.push_back(weight);
+    }
+
+    size_t Ensemble::size() const {
+        return members.size();
+    }
+
+    void Ensemble::infer_batch(const std::vector<double>& inputs, size_t batch, std::vector<double>& outputs,
+        ThreadPool& pool) const {
+        if (members.empty()) {
+            throw std::runtime_error("Cannot run an empty ensemble.");
+        }
+
+        std::vector<std::vector<double>> memberOutputs(members.size());
+        std::vector<std::string> errors(members.size());
+        TaskGroup group(pool);
+        for (size_t m = 0; m < members.size(); ++m) {
+            group.run([this, m, &inputs, batch, &memberOutputs, &errors]() {
+                try {
+                    members[m]->infer_batch(inputs, batch, memberOutputs[m]);
+                }
+                catch (const std::exception& e) {
+                    errors[m] = e.what();
+                }
+            });
+        }
+        group.wait();
+
+        for (const std::string& error : errors) {
+            if (!error.empty()) throw std::runtime_error("Ensemble member failed: " + error);
+        }
+
+        double total = 0.0;
+        for (double w : weights) total += w;
+        if (total == 0.0) throw std::runtime_error("Ensemble weights sum to zero.");
+
+        outputs.assign(memberOutputs[0].size(), 0.0);
+        for (size_t m = 0; m < members.size(); ++m) {
+            double share = weights[m] / total;
+            for (size_t i = 0; i < outputs.size(); ++i) outputs[i] += share * memberOutputs[m][i];
+        }
+    }
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Net.hpp"
+#include "Tensor.hpp"
+#include "ThreadPool.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nn {
+
+    // One model of a sweep. topology lists the node count of every layer, the last being the output
+    // layer; the first layer reads the data's features, as in Main.cpp.
+    struct SweepConfig {
+        std::string name;
+        std::vector<int> topology;
+        ActivationFunction hidden_activation = ActivationFunction::Sigmoid;
+        ActivationFunction output_activation = ActivationFunction::Sigmoid;
+        OptimizerType optimizer = OptimizerType::SGD;
+        double learning_rate = 0.1;
+        int saturation_threshold = 10;
+        int epochs = 1000;
+    };
+
+    struct SweepResult {
+        SweepConfig config;
+        double final_loss = 0.0;     // mean squared error over the training data
+        double seconds = 0.0;
+        std::string error;           // set if building or training the net threw
+        std::unique_ptr<Net> net;
+    };
+
+    // Trains one Net per config on the pool, all reading the same data. Results come back in config
+    // order; the trained nets are kept only when keep_nets is set.
+    std::vector<SweepResult> run_sweep(const std::vector<SweepConfig>& configs, const Tensor& data,
+        ThreadPool& pool, bool keep_nets = true);
+
+    // Averages the outputs of several nets of the same input and output size. Members are only read,
+    // so they must not be trained while the ensemble is in use.
+    class Ensemble {
+    public:
+        void add_member(const Net* net, double weight = 1.0);
+
+        // Every member runs its own batched forward pass as a pool task, then the outputs are combined
+        // with the members' weights.
+        void infer_batch(const std::vector<double>& inputs, size_t batch, std::vector<double>& outputs,
+            ThreadPool& pool) const;
+
+        size_t size() const;
+
+    private:
+        std::vector<const Net*> members;
+        std::vector<double> weights;
+    };
+
+}
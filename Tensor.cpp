@@ -1,6 +1,8 @@
 #include "Tensor.hpp"
 #include <Eigen/Dense>
 #include <iostream>
+#include <cmath>
+#include <stdexcept>
 
 namespace nn {
 
@@ -36,6 +38,83 @@ namespace nn {
         return inputs.empty() ? 0 : inputs[0].size();
     }
 
+    SparseTensor::SparseTensor(size_t num_features)
+        : row_offsets(1, 0), num_features(num_features) {}
+
+    SparseTensor SparseTensor::fromDense(const Tensor& dense, double zero_threshold) {
+        SparseTensor sparse(dense.getNumFeatures());
+        std::vector<int> indices;
+        std::vector<double> row_values;
+        for (size_t i = 0; i < dense.inputs.size(); ++i) {
+            indices.clear();
+            row_values.clear();
+            for (size_t j = 0; j < dense.inputs[i].size(); ++j) {
+                if (std::abs(dense.inputs[i][j]) > zero_threshold) {
+                    indices.push_back(static_cast<int>(j));
+                    row_values.push_back(dense.inputs[i][j]);
+                }
+            }
+            sparse.addRow(indices, row_values, i < dense.labels.size() ? dense.labels[i] : std::vector<double>());
+        }
+        return sparse;
+    }
+
+    void SparseTensor::addRow(const std::vector<int>& indices, const std::vector<double>& row_values,
+        const std::vector<double>& label) {
+        if (indices.size() != row_values.size()) {
+            throw std::invalid_argument("Sparse row needs one value per index.");
+        }
+        for (size_t k = 0; k < indices.size(); ++k) {
+            if (indices[k] < 0 || static_cast<size_t>(indices[k]) >= num_features) {
+                throw std::out_of_range("Sparse column index out of range.");
+            }
+            if (k > 0 && indices[k] <= indices[k - 1]) {
+                throw std::invalid_argument("Sparse column indices must be strictly increasing.");
+            }
+        }
+
+        column_indices.insert(column_indices.end(), indices.begin(), indices.end());
+        values.insert(values.end(), row_values.begin(), row_values.end());
+        row_offsets.push_back(column_indices.size());
+        labels.push_back(label);
+    }
+
+    SparseRow SparseTensor::getRow(size_t index) const {
+        if (index + 1 >= row_offsets.size()) throw std::out_of_range("Invalid sample index");
+        size_t begin = row_offsets[index];
+        return SparseRow{ column_indices.data() + begin, values.data() + begin, row_offsets[index + 1] - begin };
+    }
+
+    std::vector<double> SparseTensor::getDenseRow(size_t index) const {
+        SparseRow row = getRow(index);
+        std::vector<double> dense(num_features, 0.0);
+        for (size_t k = 0; k < row.nnz; ++k) dense[row.indices[k]] = row.values[k];
+        return dense;
+    }
+
+    void SparseTensor::printInputs() const {
+        std::cout << "Inputs (" << getNumSamples() << " x " << num_features << ", " << getNumNonZeros() << " non-zero):\n";
+        for (size_t i = 0; i < getNumSamples(); ++i) {
+            SparseRow row = getRow(i);
+            for (size_t k = 0; k < row.nnz; ++k) {
+                std::cout << row.indices[k] << ":" << row.values[k] << " ";
+            }
+            std::cout << "\n";
+        }
+    }
+
+    size_t SparseTensor::getNumSamples() const {
+        return row_offsets.size() - 1;
+    }
+
+    size_t SparseTensor::getNumFeatures() const {
+        return num_features;
+    }
+
+    size_t SparseTensor::getNumNonZeros() const {
+        return values.size();
+    }
+
     void performPCA(const std::vector<std::vector<double>>& input_data, int num_components) {
         if (input_data.empty()) {
             std::cerr << "Input data is empty.\n";
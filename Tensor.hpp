@@ -20,6 +20,41 @@ namespace nn {
         size_t getNumFeatures() const;
     };
 
+    // One sample of a SparseTensor: nnz (column, value) pairs, columns in increasing order.
+    struct SparseRow {
+        const int* indices;
+        const double* values;
+        size_t nnz;
+    };
+
+    // Samples in compressed sparse row (CSR) form, for inputs that are almost all zeros.
+    // Row i's non-zeros are values[row_offsets[i], row_offsets[i + 1]) at columns column_indices[...].
+    class SparseTensor {
+    public:
+        std::vector<size_t> row_offsets;
+        std::vector<int> column_indices;
+        std::vector<double> values;
+        std::vector<std::vector<double>> labels;
+        size_t num_features;
+
+        explicit SparseTensor(size_t num_features);
+
+        // Keeps entries whose magnitude is above zero_threshold.
+        static SparseTensor fromDense(const Tensor& dense, double zero_threshold = 0.0);
+
+        void addRow(const std::vector<int>& indices, const std::vector<double>& row_values,
+            const std::vector<double>& label = {});
+
+        SparseRow getRow(size_t index) const;
+        std::vector<double> getDenseRow(size_t index) const;
+
+        void printInputs() const;
+
+        size_t getNumSamples() const;
+        size_t getNumFeatures() const;
+        size_t getNumNonZeros() const;
+    };
+
     // PCA function
     void performPCA(const std::vector<std::vector<double>>& input_data, int num_components);
 
@@ -0,0 +1,136 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace nn {
+
+    namespace {
+        // Which pool and deque the current thread works for, so nested submits stay local.
+        thread_local const ThreadPool* current_pool = nullptr;
+        thread_local size_t current_index = 0;
+    }
+
+    ThreadPool::ThreadPool(size_t threads) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+        for (size_t i = 0; i < threads; ++i) queues.emplace_back(new Queue());
+        for (size_t i = 0; i < threads; ++i) workers.emplace_back(&ThreadPool::run, this, i);
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            stopping = true;
+        }
+        work_available.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    size_t ThreadPool::size() const {
+        return workers.size();
+    }
+
+    void ThreadPool::submit(std::function<void()> task) {
+        size_t index = current_pool == this ? current_index : next_queue++ % queues.size();
+
+        {
+            // Counted under the lock so a worker about to sleep cannot miss it; a worker that wakes
+            // before the push below lands just looks again.
+            std::lock_guard<std::mutex> lock(state_mutex);
+            ++unfinished;
+            ++queued;
+        }
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        work_available.notify_one();
+    }
+
+    void ThreadPool::wait() {
+        std::unique_lock<std::mutex> lock(state_mutex);
+        all_done.wait(lock, [this]() { return unfinished == 0; });
+    }
+
+    bool ThreadPool::take(size_t index, std::function<void()>& task) {
+        {
+            Queue& own = *queues[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+
+        for (size_t offset = 1; offset < queues.size(); ++offset) {
+            Queue& victim = *queues[(index + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ThreadPool::run(size_t index) {
+        current_pool = this;
+        current_index = index;
+
+        std::function<void()> task;
+        while (true) {
+            if (take(index, task)) {
+                --queued;
+                try {
+                    task();
+                }
+                catch (const std::exception& e) {
+                    std::cerr << "ThreadPool task failed: " << e.what() << "\n";
+                }
+                task = nullptr;
+
+                std::lock_guard<std::mutex> lock(state_mutex);
+                if (--unfinished == 0) all_done.notify_all();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(state_mutex);
+            work_available.wait(lock, [this]() { return stopping || queued > 0; });
+            if (stopping && queued == 0) return;
+        }
+    }
+
+    TaskGroup::TaskGroup(ThreadPool& pool_)
+        : pool(pool_) {}
+
+    TaskGroup::~TaskGroup() {
+        wait();
+    }
+
+    void TaskGroup::run(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++pending;
+        }
+        pool.submit([this, task]() {
+            try {
+                task();
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0) done.notify_all();
+                throw;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) done.notify_all();
+        });
+    }
+
+    void TaskGroup::wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return pending == 0; });
+    }
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nn {
+
+    // Fixed set of worker threads, each with its own task deque. A worker takes new work from the back
+    // of its own deque and, when that runs dry, steals from the front of the others', so uneven tasks
+    // (a large net next to many small ones) still keep every core busy.
+    class ThreadPool {
+    public:
+        // 0 threads means one per hardware thread.
+        explicit ThreadPool(size_t threads = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Called from a worker, the task goes on that worker's own deque; otherwise the deques take turns.
+        void submit(std::function<void()> task);
+
+        // Blocks until every submitted task has finished. Must not be called from a worker; use a
+        // TaskGroup to wait for a subset.
+        void wait();
+
+        size_t size() const;
+
+    private:
+        struct Queue {
+            std::deque<std::function<void()>> tasks;
+            std::mutex mutex;
+        };
+
+        void run(size_t index);
+        bool take(size_t index, std::function<void()>& task);
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+
+        std::atomic<size_t> next_queue{ 0 };
+        std::atomic<size_t> queued{ 0 };
+        size_t unfinished = 0;
+        bool stopping = false;
+
+        std::mutex state_mutex;
+        std::condition_variable work_available;
+        std::condition_variable all_done;
+    };
+
+    // Tracks just the tasks submitted through it, so callers can wait for their own work while the
+    // pool is shared with others. Like ThreadPool::wait, wait() is not for use inside a pool task.
+    class TaskGroup {
+    public:
+        explicit TaskGroup(ThreadPool& pool);
+        ~TaskGroup();
+
+        void run(std::function<void()> task);
+        void wait();
+
+    private:
+        ThreadPool& pool;
+        size_t pending = 0;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+
+}